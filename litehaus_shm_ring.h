@@ -0,0 +1,282 @@
+// Shared-memory beacon ring: the listener publishes every decoded beacon into
+// a POSIX shared memory object (/dev/shm/<name> on Linux), and any number of
+// local processes tail it with plain loads - no syscalls per record, and a
+// reader can never slow the listener down.
+//
+// Layout: one ring_header followed by `capacity` fixed-size ring_slots.
+// Record n lives in slot n & (capacity - 1). Each slot is a seqlock: its
+// sequence is 2n+1 while record n is being written and 2n+2 once it is
+// complete, so a reader knows whether it got the record it asked for, is
+// early, or has been lapped by the writer.
+//
+// Readers only need this header:
+//
+//     whispr::shm::ring_reader reader;
+//     if (reader.open("litehaus")) {
+//         whispr::shm::beacon_record record;
+//         while (running) {
+//             if (reader.next(record) == whispr::shm::read_status::empty) idle();
+//         }
+//     }
+//
+// Link with -lrt on libc versions older than glibc 2.34.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace whispr::shm {
+
+inline constexpr uint64_t ring_magic = 0x474E495248534C57ULL;   // "WLSHRING"
+inline constexpr uint32_t layout_version = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlocks need lock-free 64-bit atomics");
+
+// Strings are NUL-padded and truncated to fit
+struct beacon_record {
+    uint64_t timestamp_ns;          // Sender's clock
+    uint64_t received_ns;           // Listener's clock when parsed
+    uint64_t sequence_number;
+    double parse_time_us;
+    uint32_t message_size;
+    uint32_t simd_capability;
+    uint8_t is_critical;
+    uint8_t reserved[7];
+    char source_id[48];
+    char message_type[32];
+    char peer[48];
+};
+
+struct alignas(64) ring_slot {
+    std::atomic<uint64_t> sequence;
+    beacon_record record;
+};
+
+struct alignas(64) ring_header {
+    std::atomic<uint64_t> magic;    // Written last by the creator
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;              // Power of two
+    uint64_t created_ns;
+    alignas(64) std::atomic<uint64_t> head;     // Records claimed so far
+};
+
+static_assert(sizeof(ring_slot) == 192, "ring_slot layout is part of the format");
+static_assert(sizeof(ring_header) == 128, "ring_header layout is part of the format");
+
+template<size_t N>
+inline void copy_field(char (&field)[N], std::string_view value) {
+    size_t length = std::min(value.size(), N - 1);
+    std::memcpy(field, value.data(), length);
+    std::memset(field + length, 0, N - length);
+}
+
+inline size_t mapping_size(uint64_t capacity) {
+    return sizeof(ring_header) + capacity * sizeof(ring_slot);
+}
+
+// Owns the shared memory object; removed again when the writer goes away.
+// Producers claim slots with one fetch_add, so any thread may publish; one
+// that laps a producer still filling the same slot waits for it to finish.
+class ring_writer {
+public:
+    ring_writer() = default;
+    ring_writer(const ring_writer&) = delete;
+    ring_writer& operator=(const ring_writer&) = delete;
+    ~ring_writer() { close(); }
+
+    bool create(const std::string& name, uint64_t capacity, uint64_t now_ns) {
+#ifndef _WIN32
+        uint64_t size = 2;
+        while (size < capacity) size <<= 1;
+
+        name_ = name.starts_with('/') ? name : "/" + name;
+        int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0) return false;
+
+        length_ = mapping_size(size);
+        void* memory = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(length_)) == 0) {
+            memory = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(name_.c_str());
+            return false;
+        }
+
+        // A fresh object is zero-filled, so every slot starts out "never written"
+        header_ = static_cast<ring_header*>(memory);
+        header_->version = layout_version;
+        header_->slot_size = sizeof(ring_slot);
+        header_->capacity = size;
+        header_->created_ns = now_ns;
+        header_->head.store(0, std::memory_order_relaxed);
+        slots_ = reinterpret_cast<ring_slot*>(header_ + 1);
+        mask_ = size - 1;
+
+        // Readers check the magic last, so they never see a half-built header
+        header_->magic.store(ring_magic, std::memory_order_release);
+        return true;
+#else
+        (void)name; (void)capacity; (void)now_ns;
+        return false;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (!header_) return;
+        munmap(header_, length_);
+        shm_unlink(name_.c_str());
+        header_ = nullptr;
+        slots_ = nullptr;
+#endif
+    }
+
+    // Fill is called with the slot's record to write it in place
+    template<typename Fill>
+    void publish(Fill&& fill) {
+        uint64_t n = header_->head.fetch_add(1, std::memory_order_relaxed);
+        ring_slot& slot = slots_[n & mask_];
+
+        // Record n - capacity must be complete first, or its late 2n+2 store
+        // would land on top of ours and readers would see the wrong record
+        uint64_t previous = n > mask_ ? 2 * (n - mask_ - 1) + 2 : 0;
+        while (slot.sequence.load(std::memory_order_acquire) != previous) {
+            std::this_thread::yield();
+        }
+
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fill(slot.record);
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+    }
+
+    uint64_t published() const { return header_ ? header_->head.load(std::memory_order_relaxed) : 0; }
+    uint64_t capacity() const { return header_ ? header_->capacity : 0; }
+
+private:
+    std::string name_;
+    ring_header* header_ = nullptr;
+    ring_slot* slots_ = nullptr;
+    size_t length_ = 0;
+    uint64_t mask_ = 0;
+};
+
+enum class read_status { record, empty, overrun };
+
+// Read-only mapping; each reader keeps its own cursor and never writes
+// anything the writer or other readers can see.
+class ring_reader {
+public:
+    ring_reader() = default;
+    ring_reader(const ring_reader&) = delete;
+    ring_reader& operator=(const ring_reader&) = delete;
+    ~ring_reader() { close(); }
+
+    // Starts at the newest record; seek_oldest() replays what is still held
+    bool open(const std::string& name) {
+#ifndef _WIN32
+        std::string path = name.starts_with('/') ? name : "/" + name;
+        int fd = shm_open(path.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+
+        struct stat info{};
+        void* memory = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ring_header)) {
+            length_ = static_cast<size_t>(info.st_size);
+            memory = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (memory == MAP_FAILED) return false;
+
+        header_ = static_cast<const ring_header*>(memory);
+        bool valid = header_->magic.load(std::memory_order_acquire) == ring_magic &&
+                     header_->version == layout_version &&
+                     header_->slot_size == sizeof(ring_slot) &&
+                     length_ >= mapping_size(header_->capacity);
+        if (!valid) {
+            close();
+            return false;
+        }
+
+        slots_ = reinterpret_cast<const ring_slot*>(header_ + 1);
+        mask_ = header_->capacity - 1;
+        seek_latest();
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (header_) munmap(const_cast<ring_header*>(header_), length_);
+#endif
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+
+    void seek_latest() { cursor_ = header_->head.load(std::memory_order_acquire); }
+
+    void seek_oldest() {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        cursor_ = head > header_->capacity ? head - header_->capacity : 0;
+    }
+
+    // On overrun the cursor has already moved to the oldest record still
+    // held; lost() counts what was skipped
+    read_status next(beacon_record& out) {
+        const ring_slot& slot = slots_[cursor_ & mask_];
+        uint64_t expected = 2 * cursor_ + 2;
+
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before < expected) return read_status::empty;
+
+        if (before == expected) {
+            std::memcpy(&out, &slot.record, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                cursor_++;
+                return read_status::record;
+            }
+        }
+
+        // The writer has lapped us; skip ahead with some slack so the next
+        // read is not overwritten straight away
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        uint64_t resume = head - header_->capacity + header_->capacity / 8;
+        lost_ += resume - cursor_;
+        cursor_ = resume;
+        return read_status::overrun;
+    }
+
+    uint64_t position() const { return cursor_; }
+    uint64_t lost() const { return lost_; }
+    uint64_t capacity() const { return header_ ? header_->capacity : 0; }
+
+private:
+    const ring_header* header_ = nullptr;
+    const ring_slot* slots_ = nullptr;
+    size_t length_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+};
+
+} // namespace whispr::shm
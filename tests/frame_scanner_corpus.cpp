@@ -0,0 +1,178 @@
+// Corpus check for frame_scanner: every stream must frame exactly as the
+// original brace-counting loop did, however recv happens to segment it.
+//
+//   frame_scanner_corpus [FILE...]
+//
+// A generated corpus is always checked (beacons, batches, escape-heavy
+// strings, braces inside strings, and malformed frames with backslashes
+// outside strings). Files given on the command line are checked as whole
+// streams in addition to it.
+
+#define LITEHAUS_NO_MAIN
+#include "../whispr_network_monitor_dashboard.cpp"
+
+#include <fstream>
+#include <random>
+
+namespace {
+
+using namespace whispr::network;
+
+// The loop handle_client used before the scanner, kept as the reference
+std::vector<size_t> reference_frames(std::string_view stream) {
+    std::vector<size_t> frame_ends;
+    int brace_count = 0;
+    bool in_string = false;
+    bool escape_next = false;
+
+    for (size_t i = 0; i < stream.size(); ++i) {
+        char c = stream[i];
+        if (!escape_next) {
+            if (c == '"' && !in_string) {
+                in_string = true;
+            } else if (c == '"' && in_string) {
+                in_string = false;
+            } else if (c == '\\' && in_string) {
+                escape_next = true;
+                continue;
+            } else if (!in_string) {
+                if (c == '{') brace_count++;
+                else if (c == '}') {
+                    brace_count--;
+                    if (brace_count == 0) frame_ends.push_back(i + 1);
+                }
+            }
+        } else {
+            escape_next = false;
+        }
+    }
+    return frame_ends;
+}
+
+// Feeds the stream in random pieces and drops framed bytes the way ingest does
+std::vector<size_t> scanner_frames(std::string_view stream, std::mt19937_64& rng) {
+    std::vector<size_t> frame_ends;
+    std::vector<size_t> found;
+    std::string buffer;
+    frame_scanner scanner;
+    size_t base = 0;
+
+    for (size_t pos = 0; pos < stream.size(); ) {
+        size_t piece = std::min<size_t>(stream.size() - pos, 1 + rng() % 300);
+        buffer.append(stream.substr(pos, piece));
+        pos += piece;
+
+        found.clear();
+        scanner.scan(buffer, found);
+        if (found.empty()) continue;
+
+        for (size_t end : found) frame_ends.push_back(base + end);
+        size_t start = found.back();
+        buffer.erase(0, start);
+        scanner.consume(start);
+        base += start;
+    }
+    return frame_ends;
+}
+
+std::string random_text(std::mt19937_64& rng, size_t length) {
+    static constexpr std::string_view alphabet = "abc XYZ{}[]\":,\\\\\\n\t0123456789";
+    std::string text;
+    for (size_t i = 0; i < length; ++i) text += alphabet[rng() % alphabet.size()];
+    return text;
+}
+
+beacon_message random_beacon(std::mt19937_64& rng, uint32_t sequence) {
+    beacon_message msg{};
+    msg.source_id = (rng() % 4 == 0) ? std::string("we\"ird\\id{") : std::string("whispr-lighthouse-v3");
+    msg.message_type = (sequence % 100 == 0) ? "critical" : "heartbeat";
+    msg.timestamp_ns = rng();
+    msg.payload = (rng() % 3 == 0) ? random_text(rng, rng() % 200) : "Lighthouse V3 - SIMD:256 Seq:" + std::to_string(sequence);
+    msg.sequence_number = sequence;
+    msg.is_critical = sequence % 100 == 0;
+    msg.simd_capability = 256;
+    return msg;
+}
+
+std::string generated_corpus(std::mt19937_64& rng) {
+    std::string stream;
+    std::string frame;
+
+    // Backslashes outside strings escape nothing, so a quote after one still
+    // opens a string; none of these may leave a stray top-level '}'
+    static constexpr std::string_view malformed[] = {
+        "\\{\"a\":1}",
+        "\\\\\\{\"a\":\"}\"}",
+        "\\\"junk{\"{\"a\":1}",
+        "{\"a\":1,\\\"b\":\"{\"}",
+        "{\"a\":\\{}}",
+        "{\"a\":[\\\\\"x\\\"}\"]}\\",
+    };
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        frame.clear();
+        switch (rng() % 5) {
+            case 0: {
+                batch_message batch{};
+                batch.batch_id = i;
+                size_t count = 1 + rng() % 12;
+                for (size_t m = 0; m < count; ++m) batch.messages.push_back(random_beacon(rng, i));
+                wire_encoder::serialize(batch, frame);
+                break;
+            }
+            case 1:
+                // Braces, quotes and runs of escaped backslashes straddling block edges
+                frame = "{\"payload\":\"" + std::string(2 * (rng() % 35), '\\') + "\\\"}{\",\"nested\":{\"a\":[{},{}]}}";
+                break;
+            case 2:
+                frame = std::string(rng() % 70, ' ');
+                frame += malformed[rng() % std::size(malformed)];
+                break;
+            default:
+                wire_encoder::serialize(random_beacon(rng, i), frame);
+                break;
+        }
+        stream += frame;
+        if (rng() % 2) stream += (rng() % 2) ? "\n" : " \r\n\t";
+    }
+    return stream;
+}
+
+bool check(std::string_view name, std::string_view stream, std::mt19937_64& rng) {
+    std::vector<size_t> expected = reference_frames(stream);
+
+    for (int round = 0; round < 8; ++round) {
+        std::vector<size_t> actual = scanner_frames(stream, rng);
+        if (actual != expected) {
+            auto [a, e] = std::mismatch(actual.begin(), actual.end(), expected.begin(), expected.end());
+            std::cerr << ansi::BRIGHT_RED << "❌ " << name << ": frame " << (e - expected.begin())
+                      << " differs (scanner " << (a == actual.end() ? 0 : *a)
+                      << ", reference " << (e == expected.end() ? 0 : *e) << ")" << ansi::RESET << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << ansi::BRIGHT_GREEN << "✅ " << name << ": " << expected.size() << " frames, "
+              << stream.size() << " bytes identical" << ansi::RESET << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::mt19937_64 rng(0x11ec4a05);
+    bool ok = check("generated corpus", generated_corpus(rng), rng);
+
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::cerr << ansi::BRIGHT_RED << "❌ Cannot read " << argv[i] << ansi::RESET << std::endl;
+            ok = false;
+            continue;
+        }
+        std::string stream((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        ok &= check(argv[i], stream, rng);
+    }
+
+    return ok ? 0 : 1;
+}
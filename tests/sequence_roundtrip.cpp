@@ -0,0 +1,119 @@
+// Sequence numbers must survive the JSON wire exactly, well past the six
+// significant digits a %g rendering keeps, or sequence_tracker reports loss,
+// duplicates and reordering that never happened.
+//
+//   sequence_roundtrip
+//
+// Encodes a run of beacons and batches straddling 10^6 through the direct
+// serializer and the beacon template, decodes them again and feeds the
+// decoded numbers to a sequence_tracker, which must see a clean stream.
+
+#define LITEHAUS_NO_MAIN
+#include "../whispr_network_monitor_dashboard.cpp"
+
+namespace {
+
+using namespace whispr::network;
+
+constexpr uint32_t first_sequence = 999000;
+constexpr uint32_t last_sequence = 1003000;
+
+bool fail(std::string_view what, uint64_t expected, uint64_t actual) {
+    std::cerr << ansi::BRIGHT_RED << "❌ " << what << ": expected " << expected
+              << ", got " << actual << ansi::RESET << std::endl;
+    return false;
+}
+
+bool clean(std::string_view name, const sequence_tracker& tracker) {
+    sequence_summary summary = tracker.summary();
+    uint64_t expected = last_sequence - first_sequence;
+    if (summary.received != expected) return fail(std::string(name) + " received", expected, summary.received);
+    if (summary.lost != 0) return fail(std::string(name) + " lost", 0, summary.lost);
+    if (summary.duplicates != 0) return fail(std::string(name) + " duplicates", 0, summary.duplicates);
+    if (summary.reordered != 0) return fail(std::string(name) + " reordered", 0, summary.reordered);
+
+    std::cout << ansi::BRIGHT_GREEN << "✅ " << name << ": " << summary.received
+              << " beacons from " << first_sequence << ", none lost, duplicated or reordered"
+              << ansi::RESET << std::endl;
+    return true;
+}
+
+beacon_message beacon(uint32_t sequence) {
+    beacon_message msg{};
+    msg.source_id = "whispr-lighthouse-v3";
+    msg.message_type = "heartbeat";
+    msg.timestamp_ns = 1760000000000000000ULL + sequence;
+    msg.payload = "Lighthouse V3 - SIMD:256 Seq:" + std::to_string(sequence);
+    msg.sequence_number = sequence;
+    msg.simd_capability = 256;
+    msg.message_size = 1048576;
+    return msg;
+}
+
+bool serializer_roundtrip() {
+    sequence_tracker tracker;
+    beacon_message decoded;
+    batch_message batch;
+    std::string frame;
+
+    for (uint32_t sequence = first_sequence; sequence < last_sequence; ++sequence) {
+        frame.clear();
+        wire_encoder::serialize(beacon(sequence), frame);
+        if (wire_decoder::decode(frame, decoded, batch) != wire_decoder::frame_kind::beacon) {
+            return fail("beacon frame kind", 0, 1);
+        }
+        if (decoded.sequence_number != sequence) return fail("beacon sequence_number", sequence, decoded.sequence_number);
+        if (decoded.message_size != 1048576) return fail("beacon message_size", 1048576, decoded.message_size);
+        tracker.record(decoded.sequence_number, decoded.timestamp_ns, decoded.timestamp_ns);
+    }
+    return clean("serializer", tracker);
+}
+
+bool batch_roundtrip() {
+    sequence_tracker tracker;
+    beacon_message decoded;
+    batch_message batch;
+    std::string frame;
+
+    for (uint32_t sequence = first_sequence; sequence < last_sequence; sequence += 10) {
+        batch_message outgoing{};
+        outgoing.batch_id = sequence;
+        for (uint32_t i = 0; i < 10; ++i) outgoing.messages.push_back(beacon(sequence + i));
+
+        frame.clear();
+        wire_encoder::serialize(outgoing, frame);
+        if (wire_decoder::decode(frame, decoded, batch) != wire_decoder::frame_kind::batch) {
+            return fail("batch frame kind", 0, 1);
+        }
+        if (batch.batch_id != sequence) return fail("batch_id", sequence, batch.batch_id);
+        for (const auto& msg : batch.messages) tracker.record(msg.sequence_number, msg.timestamp_ns, msg.timestamp_ns);
+    }
+    return clean("batches", tracker);
+}
+
+bool template_roundtrip() {
+    sequence_tracker tracker;
+    beacon_message decoded;
+    batch_message batch;
+    wire_encoder::beacon_template bytes;
+    bytes.render(beacon(0), "Lighthouse V3 - SIMD:256 Seq:");
+
+    for (uint32_t sequence = first_sequence; sequence < last_sequence; ++sequence) {
+        std::string_view frame = bytes.patch(1760000000000000000ULL + sequence, sequence, false);
+        if (wire_decoder::decode(frame, decoded, batch) != wire_decoder::frame_kind::beacon) {
+            return fail("template frame kind", 0, 1);
+        }
+        if (decoded.sequence_number != sequence) return fail("template sequence_number", sequence, decoded.sequence_number);
+        tracker.record(decoded.sequence_number, decoded.timestamp_ns, decoded.timestamp_ns);
+    }
+    return clean("template", tracker);
+}
+
+} // namespace
+
+int main() {
+    bool ok = serializer_roundtrip();
+    ok &= batch_roundtrip();
+    ok &= template_roundtrip();
+    return ok ? 0 : 1;
+}
@@ -12,10 +12,21 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <algorithm>
 #include <csignal>
 #include <cstdlib>
 #include <sstream>
 #include <iomanip>
+#include <unordered_map>
+#include <deque>
+#include <array>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <bit>
+#include <limits>
+#include <filesystem>
 
 // Windows-specific networking headers
 #ifdef _WIN32
@@ -29,9 +40,38 @@
     #include <unistd.h>
     #include <arpa/inet.h>
     #include <sys/socket.h>
+    #include <sys/select.h>
+    #include <netdb.h>
     #include <netinet/tcp.h>
 #endif
 
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <netinet/udp.h>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <linux/futex.h>
+    
+    // Older libc headers predate UDP GSO; the kernel decides at runtime
+    #ifndef UDP_SEGMENT
+        #define UDP_SEGMENT 103
+    #endif
+    #ifndef SOL_UDP
+        #define SOL_UDP 17
+    #endif
+#endif
+
+#include "litehaus_shm_ring.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
 // Beautiful ANSI color codes for gorgeous output! 🎨
 namespace ansi {
     // Text colors
@@ -103,6 +143,16 @@ namespace format {
         return ss.str();
     }
     
+    // Wall-clock time of an epoch timestamp in nanoseconds
+    std::string timestamp_of(uint64_t epoch_ns) {
+        auto time_t = static_cast<std::time_t>(epoch_ns / 1000000000);
+        
+        std::stringstream ss;
+        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        ss << "." << std::setfill('0') << std::setw(3) << (epoch_ns / 1000000) % 1000;
+        return ss.str();
+    }
+    
     std::string format_bytes(uint64_t bytes) {
         const char* units[] = {"B", "KB", "MB", "GB", "TB"};
         int unit = 0;
@@ -456,14 +506,461 @@ namespace simple_json {
             return arr;
         }
     };
+
+    // Zero-copy parse mode: the document owns the source buffer and every
+    // string/number token is a view into it. Nodes live in one flat tape so a
+    // reused document parses without touching the allocator.
+    class json_document;
+
+    class json_view {
+    public:
+        using type = json_value::type;
+
+        json_view() = default;
+
+        type get_type() const;
+        bool is_null() const { return get_type() == type::null_val; }
+        bool is_object() const { return get_type() == type::object_val; }
+
+        // Undecoded token text (string contents without quotes, or number literal)
+        std::string_view raw() const;
+
+        // Getters - unescaping happens here, never during parse
+        std::string as_string() const {
+            std::string result;
+            decode_into(result);
+            return result;
+        }
+        void decode_into(std::string& out) const;
+        double as_number() const;
+        uint64_t as_uint64() const;
+        uint32_t as_uint32() const { return static_cast<uint32_t>(as_uint64()); }
+        bool as_bool() const;
+
+        bool has(std::string_view key) const { return !get(key).is_null(); }
+        json_view get(std::string_view key) const;
+        size_t size() const;
+        json_view at(size_t index) const;
+
+        // Object iteration without key lookups: fn(key_view, value_view)
+        template<typename Fn>
+        void for_each_member(Fn&& fn) const;
+        
+        // Array iteration without index walks: fn(element_view)
+        template<typename Fn>
+        void for_each_element(Fn&& fn) const;
+
+    private:
+        friend class json_document;
+        json_view(const json_document* doc, uint32_t index) : doc_(doc), index_(index) {}
+
+        const json_document* doc_ = nullptr;
+        uint32_t index_ = 0;
+    };
+
+    class json_document {
+    public:
+        json_document() = default;
+        json_document(const json_document&) = delete;
+        json_document& operator=(const json_document&) = delete;
+
+        // Takes ownership of the buffer; returns false (and a null root) on malformed input
+        bool parse(std::string buffer) {
+            buffer_ = std::move(buffer);
+            nodes_.clear();
+
+            std::string_view str(buffer_);
+            size_t pos = 0;
+            if (!parse_value(str, pos, 0)) {
+                nodes_.clear();
+                return false;
+            }
+            return true;
+        }
+
+        json_view root() const {
+            return nodes_.empty() ? json_view() : json_view(this, 0);
+        }
+
+        const std::string& buffer() const { return buffer_; }
+
+    private:
+        friend class json_view;
+
+        struct node {
+            json_value::type kind;
+            bool escaped;          // string token contains escape sequences
+            uint32_t next;         // index one past this node's subtree
+            uint32_t count;        // members (objects) or elements (arrays)
+            std::string_view text; // string contents or number literal
+        };
+
+        static constexpr uint32_t max_depth = 64;
+
+        std::string buffer_;
+        std::vector<node> nodes_;
+
+        uint32_t push_node(json_value::type kind, std::string_view text = {}, bool escaped = false) {
+            uint32_t index = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(node{kind, escaped, index + 1, 0, text});
+            return index;
+        }
+
+        static void skip_whitespace(std::string_view str, size_t& pos) {
+            while (pos < str.length() && (str[pos] == ' ' || str[pos] == '\t' ||
+                   str[pos] == '\n' || str[pos] == '\r')) {
+                pos++;
+            }
+        }
+
+        static bool scan_string(std::string_view str, size_t& pos, std::string_view& text, bool& escaped) {
+            if (pos >= str.length() || str[pos] != '"') return false;
+            size_t start = ++pos;
+            escaped = false;
+
+            while (true) {
+                const void* hit = std::memchr(str.data() + pos, '"', str.length() - pos);
+                if (!hit) return false;
+                size_t quote = static_cast<const char*>(hit) - str.data();
+
+                size_t backslashes = 0;
+                while (quote - backslashes > start && str[quote - backslashes - 1] == '\\') backslashes++;
+                if (backslashes > 0) escaped = true;
+
+                pos = quote + 1;
+                if ((backslashes & 1) == 0) {
+                    text = str.substr(start, quote - start);
+                    if (!escaped) escaped = std::memchr(text.data(), '\\', text.size()) != nullptr;
+                    return true;
+                }
+            }
+        }
+
+        bool parse_value(std::string_view str, size_t& pos, uint32_t depth) {
+            skip_whitespace(str, pos);
+            if (pos >= str.length() || depth > max_depth) return false;
+
+            char c = str[pos];
+            if (c == '"') {
+                std::string_view text;
+                bool escaped;
+                if (!scan_string(str, pos, text, escaped)) return false;
+                push_node(json_value::type::string_val, text, escaped);
+                return true;
+            }
+            if (c == '{') return parse_object(str, pos, depth);
+            if (c == '[') return parse_array(str, pos, depth);
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                size_t start = pos++;
+                while (pos < str.length() && ((str[pos] >= '0' && str[pos] <= '9') || str[pos] == '.' ||
+                       str[pos] == 'e' || str[pos] == 'E' || str[pos] == '+' || str[pos] == '-')) {
+                    pos++;
+                }
+                push_node(json_value::type::number_val, str.substr(start, pos - start));
+                return true;
+            }
+            if (str.substr(pos, 4) == "true" || str.substr(pos, 5) == "false") {
+                std::string_view text = str.substr(pos, c == 't' ? 4 : 5);
+                pos += text.size();
+                push_node(json_value::type::bool_val, text);
+                return true;
+            }
+            if (str.substr(pos, 4) == "null") {
+                pos += 4;
+                push_node(json_value::type::null_val);
+                return true;
+            }
+            return false;
+        }
+
+        bool parse_object(std::string_view str, size_t& pos, uint32_t depth) {
+            pos++;
+            uint32_t index = push_node(json_value::type::object_val);
+            uint32_t count = 0;
+
+            skip_whitespace(str, pos);
+            if (pos < str.length() && str[pos] == '}') {
+                pos++;
+                nodes_[index].next = static_cast<uint32_t>(nodes_.size());
+                return true;
+            }
+
+            while (true) {
+                skip_whitespace(str, pos);
+
+                std::string_view key;
+                bool escaped;
+                if (!scan_string(str, pos, key, escaped)) return false;
+                push_node(json_value::type::string_val, key, escaped);
+
+                skip_whitespace(str, pos);
+                if (pos >= str.length() || str[pos] != ':') return false;
+                pos++;
+
+                if (!parse_value(str, pos, depth + 1)) return false;
+                count++;
+
+                skip_whitespace(str, pos);
+                if (pos >= str.length()) return false;
+
+                if (str[pos] == '}') {
+                    pos++;
+                    break;
+                } else if (str[pos] == ',') {
+                    pos++;
+                } else {
+                    return false;
+                }
+            }
+
+            nodes_[index].count = count;
+            nodes_[index].next = static_cast<uint32_t>(nodes_.size());
+            return true;
+        }
+
+        bool parse_array(std::string_view str, size_t& pos, uint32_t depth) {
+            pos++;
+            uint32_t index = push_node(json_value::type::array_val);
+            uint32_t count = 0;
+
+            skip_whitespace(str, pos);
+            if (pos < str.length() && str[pos] == ']') {
+                pos++;
+                nodes_[index].next = static_cast<uint32_t>(nodes_.size());
+                return true;
+            }
+
+            while (true) {
+                if (!parse_value(str, pos, depth + 1)) return false;
+                count++;
+
+                skip_whitespace(str, pos);
+                if (pos >= str.length()) return false;
+
+                if (str[pos] == ']') {
+                    pos++;
+                    break;
+                } else if (str[pos] == ',') {
+                    pos++;
+                } else {
+                    return false;
+                }
+            }
+
+            nodes_[index].count = count;
+            nodes_[index].next = static_cast<uint32_t>(nodes_.size());
+            return true;
+        }
+    };
+
+    inline json_view::type json_view::get_type() const {
+        return doc_ ? doc_->nodes_[index_].kind : type::null_val;
+    }
+
+    inline std::string_view json_view::raw() const {
+        return doc_ ? doc_->nodes_[index_].text : std::string_view();
+    }
+
+    inline void json_view::decode_into(std::string& out) const {
+        out.clear();
+        if (get_type() != type::string_val) return;
+
+        const auto& n = doc_->nodes_[index_];
+        if (!n.escaped) {
+            out.assign(n.text);
+            return;
+        }
+
+        out.reserve(n.text.size());
+        for (size_t pos = 0; pos < n.text.size(); ++pos) {
+            char c = n.text[pos];
+            if (c == '\\' && pos + 1 < n.text.size()) {
+                switch (n.text[++pos]) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    default: out += n.text[pos]; break;
+                }
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    inline double json_view::as_number() const {
+        if (get_type() != type::number_val) return 0.0;
+        std::string_view text = raw();
+        double value = 0.0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    inline uint64_t json_view::as_uint64() const {
+        if (get_type() != type::number_val) return 0;
+        std::string_view text = raw();
+        uint64_t value = 0;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec == std::errc() && end == text.data() + text.size()) return value;
+        return static_cast<uint64_t>(as_number());
+    }
+
+    inline bool json_view::as_bool() const {
+        return get_type() == type::bool_val && raw() == "true";
+    }
+
+    inline json_view json_view::get(std::string_view key) const {
+        if (get_type() != type::object_val) return json_view();
+        uint32_t child = index_ + 1;
+        for (uint32_t i = 0; i < doc_->nodes_[index_].count; ++i) {
+            if (doc_->nodes_[child].text == key) return json_view(doc_, child + 1);
+            child = doc_->nodes_[child + 1].next;
+        }
+        return json_view();
+    }
+
+    inline size_t json_view::size() const {
+        type t = get_type();
+        if (t == type::array_val || t == type::object_val) return doc_->nodes_[index_].count;
+        return 0;
+    }
+
+    inline json_view json_view::at(size_t index) const {
+        if (get_type() != type::array_val || index >= size()) return json_view();
+        uint32_t child = index_ + 1;
+        for (size_t i = 0; i < index; ++i) child = doc_->nodes_[child].next;
+        return json_view(doc_, child);
+    }
+
+    template<typename Fn>
+    void json_view::for_each_member(Fn&& fn) const {
+        if (get_type() != type::object_val) return;
+        uint32_t child = index_ + 1;
+        for (uint32_t i = 0; i < doc_->nodes_[index_].count; ++i) {
+            // Keys are the raw token; beacon keys never carry escapes
+            fn(doc_->nodes_[child].text, json_view(doc_, child + 1));
+            child = doc_->nodes_[child + 1].next;
+        }
+    }
+
+    template<typename Fn>
+    void json_view::for_each_element(Fn&& fn) const {
+        if (get_type() != type::array_val) return;
+        uint32_t child = index_ + 1;
+        for (uint32_t i = 0; i < doc_->nodes_[index_].count; ++i) {
+            fn(json_view(doc_, child));
+            child = doc_->nodes_[child].next;
+        }
+    }
 } // namespace simple_json
 
 namespace whispr::network {
 
+// Process-wide string interning: each distinct source_id / message_type gets
+// a stable 32-bit id for the life of the process. Open addressing over a
+// fixed array like source_table: a lookup is one hash and a short probe
+// with no lock, and a new string claims its slot with one CAS. Entries are
+// never removed, so the text behind an id never moves.
+class string_interner {
+public:
+    static constexpr uint32_t capacity = 1u << 18;
+    static constexpr size_t max_length = 128;       // Longer strings are truncated
+    static constexpr uint32_t empty_id = 0;
+    static constexpr uint32_t overflow_id = 1;      // Shared by everything past the claim limit
+
+    static string_interner& instance() {
+        static string_interner table;
+        return table;
+    }
+
+    uint32_t intern(std::string_view text) {
+        if (text.empty()) return empty_id;
+        text = text.substr(0, max_length);
+        uint64_t key = std::hash<std::string_view>{}(text) | 1;     // Never 0
+
+        for (uint32_t probe = 0, i = static_cast<uint32_t>(key) & mask; probe <= mask; ++probe, i = (i + 1) & mask) {
+            slot& entry = slots_[i];
+            uint64_t current = entry.key.load(std::memory_order_acquire);
+
+            if (current == 0) {
+                if (count_.load(std::memory_order_relaxed) >= claim_limit) break;
+                if (entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                    uint32_t id = count_.fetch_add(1, std::memory_order_relaxed);
+                    names_[id].store(new std::string(text), std::memory_order_release);
+                    entry.id.store(id + 1, std::memory_order_release);
+                    return id;
+                }
+                // Lost the race; `current` now holds the winner's key
+            }
+
+            if (current == key) {
+                uint32_t id;
+                while ((id = entry.id.load(std::memory_order_acquire)) == 0) std::this_thread::yield();
+                if (*names_[id - 1].load(std::memory_order_acquire) == text) return id - 1;
+            }
+        }
+
+        overflowed_.fetch_add(1, std::memory_order_relaxed);
+        return overflow_id;
+    }
+
+    std::string_view name(uint32_t id) const {
+        const std::string* text = id < capacity ? names_[id].load(std::memory_order_acquire) : nullptr;
+        return text ? std::string_view(*text) : std::string_view();
+    }
+
+    uint32_t size() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t overflowed() const { return overflowed_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t mask = capacity - 1;
+    static constexpr uint32_t claim_limit = capacity - capacity / 8;   // Keep probe chains short
+
+    struct slot {
+        std::atomic<uint64_t> key{0};       // Hash of the text, 0 while empty
+        std::atomic<uint32_t> id{0};        // id + 1 once the text is published
+    };
+
+    std::unique_ptr<slot[]> slots_;
+    std::unique_ptr<std::atomic<const std::string*>[]> names_;     // Indexed by id
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint64_t> overflowed_{0};
+
+    string_interner()
+        : slots_(std::make_unique<slot[]>(capacity)),
+          names_(std::make_unique<std::atomic<const std::string*>[]>(capacity)) {
+        names_[empty_id].store(new std::string(), std::memory_order_relaxed);
+        names_[overflow_id].store(new std::string("(other)"), std::memory_order_relaxed);
+        count_.store(2, std::memory_order_release);
+    }
+
+    ~string_interner() {
+        for (uint32_t id = 0; id < capacity; ++id) delete names_[id].load(std::memory_order_relaxed);
+    }
+};
+
+// A 4-byte handle to an interned string; equal text means equal id
+struct symbol {
+    uint32_t id = string_interner::empty_id;
+
+    symbol() = default;
+    symbol(std::string_view text) : id(string_interner::instance().intern(text)) {}
+    symbol(const std::string& text) : symbol(std::string_view(text)) {}
+    symbol(const char* text) : symbol(std::string_view(text)) {}
+
+    std::string_view view() const { return string_interner::instance().name(id); }
+    bool empty() const { return id == string_interner::empty_id; }
+    friend bool operator==(symbol, symbol) = default;
+};
+
 // Data structures
 struct beacon_message {
-    std::string source_id;
-    std::string message_type;
+    symbol source_id;
+    symbol message_type;
     uint64_t timestamp_ns;
     std::string payload;
     uint32_t sequence_number;
@@ -474,8 +971,8 @@ struct beacon_message {
     
     simple_json::json_value to_json() const {
         simple_json::json_value obj;
-        obj["source_id"] = source_id;
-        obj["message_type"] = message_type;
+        obj["source_id"] = std::string(source_id.view());
+        obj["message_type"] = std::string(message_type.view());
         obj["timestamp_ns"] = timestamp_ns;
         obj["payload"] = payload;
         obj["sequence_number"] = sequence_number;
@@ -499,6 +996,34 @@ struct beacon_message {
         if (obj.has("message_size")) msg.message_size = obj.get("message_size").as_uint32();
         return msg;
     }
+    
+    // Zero-copy variant: one pass over the members; only the payload is copied
+    static beacon_message from_json(const simple_json::json_view& obj) {
+        beacon_message msg{};
+        obj.for_each_member([&msg](std::string_view key, const simple_json::json_view& value) {
+            if (key == "source_id") msg.source_id = intern(value);
+            else if (key == "message_type") msg.message_type = intern(value);
+            else if (key == "timestamp_ns") msg.timestamp_ns = value.as_uint64();
+            else if (key == "payload") value.decode_into(msg.payload);
+            else if (key == "sequence_number") msg.sequence_number = value.as_uint32();
+            else if (key == "is_critical") msg.is_critical = value.as_bool();
+            else if (key == "simd_capability") msg.simd_capability = value.as_uint32();
+            else if (key == "parse_time_us") msg.parse_time_us = value.as_number();
+            else if (key == "message_size") msg.message_size = value.as_uint32();
+        });
+        return msg;
+    }
+
+private:
+    // Plain text is interned straight from the document; escapes decode into scratch
+    static symbol intern(const simple_json::json_view& value) {
+        if (value.get_type() != simple_json::json_value::type::string_val) return {};
+        std::string_view text = value.raw();
+        if (std::memchr(text.data(), '\\', text.size()) == nullptr) return symbol(text);
+        static thread_local std::string scratch;
+        value.decode_into(scratch);
+        return symbol(scratch);
+    }
 };
 
 struct batch_message {
@@ -531,534 +1056,5767 @@ struct batch_message {
         }
         return batch;
     }
+    
+    static batch_message from_json(const simple_json::json_view& obj) {
+        batch_message batch{};
+        obj.for_each_member([&batch](std::string_view key, const simple_json::json_view& value) {
+            if (key == "batch_id") batch.batch_id = value.as_uint32();
+            else if (key == "compression_ratio") batch.compression_ratio = value.as_uint64();
+            else if (key == "messages") {
+                batch.messages.reserve(value.size());
+                value.for_each_element([&batch](const simple_json::json_view& element) {
+                    batch.messages.push_back(beacon_message::from_json(element));
+                });
+            }
+        });
+        return batch;
+    }
 };
 
-struct network_stats {
-    uint64_t packets_sent = 0;
-    uint64_t packets_received = 0;
-    uint64_t bytes_transmitted = 0;
-    double avg_latency_ms = 0.0;
-    uint32_t active_connections = 0;
-    double min_parse_time_us = 0.0;
-    double max_parse_time_us = 0.0;
-    double avg_parse_time_us = 0.0;
-    uint64_t simd_operations_count = 0;
-    uint64_t cache_hits = 0;
-    uint64_t cache_misses = 0;
+// Schema-driven decoder for the two frame shapes we know. Keys dispatch through
+// a compile-time perfect hash over the field table and values are written
+// straight into the structs - no json_value or json_document tree is built.
+namespace wire_decoder {
+
+enum class frame_kind { beacon, batch, unknown, malformed };
+
+enum class field_id : uint8_t {
+    source_id, message_type, timestamp_ns, payload, sequence_number, is_critical,
+    simd_capability, parse_time_us, message_size, messages, batch_id, compression_ratio
 };
 
-struct monitor_config {
-    std::string target_host;
-    uint16_t target_port;
-    uint16_t listen_port;
-    uint32_t beacon_interval_ms;
-    uint32_t max_concurrent_connections;
-    bool enable_compression;
-    bool enable_encryption;
-    uint32_t batch_size;
-    bool enable_simd_validation;
-    bool enable_prefetch;
-    uint32_t parse_threads;
-    uint32_t string_pool_size;
+struct field_entry {
+    std::string_view name;
+    field_id id;
 };
 
-struct performance_counters {
-    std::atomic<uint64_t> simd_string_ops{0};
-    std::atomic<uint64_t> simd_number_ops{0};
-    std::atomic<uint64_t> allocations_saved{0};
-    std::atomic<uint64_t> branch_predictions_saved{0};
-    
-    void reset() {
-        simd_string_ops = 0;
-        simd_number_ops = 0;
-        allocations_saved = 0;
-        branch_predictions_saved = 0;
-    }
+constexpr field_entry fields[] = {
+    {"source_id", field_id::source_id},
+    {"message_type", field_id::message_type},
+    {"timestamp_ns", field_id::timestamp_ns},
+    {"payload", field_id::payload},
+    {"sequence_number", field_id::sequence_number},
+    {"is_critical", field_id::is_critical},
+    {"simd_capability", field_id::simd_capability},
+    {"parse_time_us", field_id::parse_time_us},
+    {"message_size", field_id::message_size},
+    {"messages", field_id::messages},
+    {"batch_id", field_id::batch_id},
+    {"compression_ratio", field_id::compression_ratio},
 };
 
-// Windows WSA initialization
-class wsa_initializer {
-public:
-    wsa_initializer() {
-#ifdef _WIN32
-        WSADATA wsaData;
-        int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-        initialized_ = (result == 0);
-        if (!initialized_) {
-            std::cerr << ansi::BRIGHT_RED << "❌ WSAStartup failed: " << result << ansi::RESET << std::endl;
+constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);
+constexpr uint32_t hash_table_size = 32;
+
+constexpr uint32_t key_hash(std::string_view key, uint32_t seed) {
+    uint32_t h = seed ^ static_cast<uint32_t>(key.size());
+    h = (h ^ static_cast<uint8_t>(key[0])) * 0x9E3779B1u;
+    h = (h ^ static_cast<uint8_t>(key[key.size() / 2])) * 0x85EBCA6Bu;
+    h = (h ^ static_cast<uint8_t>(key[key.size() - 1])) * 0xC2B2AE35u;
+    h = (h ^ static_cast<uint8_t>(key[key.size() > 1 ? key.size() - 2 : 0])) * 0x27D4EB2Fu;
+    return (h >> 16) & (hash_table_size - 1);
+}
+
+constexpr uint32_t find_perfect_seed() {
+    for (uint32_t seed = 1; seed < 100000; ++seed) {
+        bool used[hash_table_size] = {};
+        bool collision = false;
+        for (const auto& f : fields) {
+            uint32_t slot = key_hash(f.name, seed);
+            if (used[slot]) { collision = true; break; }
+            used[slot] = true;
         }
-#else
-        initialized_ = true;
+        if (!collision) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t hash_seed = find_perfect_seed();
+static_assert(hash_seed != 0, "no collision-free seed for the beacon field table");
+
+struct slot_table {
+    int8_t slots[hash_table_size];
+};
+
+constexpr slot_table build_slot_table() {
+    slot_table table{};
+    for (auto& slot : table.slots) slot = -1;
+    for (size_t i = 0; i < field_count; ++i) {
+        table.slots[key_hash(fields[i].name, hash_seed)] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr slot_table slots = build_slot_table();
+
+// Returns the field table index for `key`, or -1 for unknown fields
+inline int lookup_field(std::string_view key) {
+    if (key.empty()) return -1;
+    int index = slots.slots[key_hash(key, hash_seed)];
+    if (index < 0 || fields[index].name != key) return -1;
+    return index;
+}
+
+class decoder {
+public:
+    explicit decoder(std::string_view frame)
+        : p_(frame.data()), end_(frame.data() + frame.size()) {}
+
+    frame_kind decode(beacon_message& beacon, batch_message& batch) {
+        reset(beacon);
+        batch.batch_id = 0;
+        batch.compression_ratio = 0;
+        size_t message_count = 0;
+
+        uint32_t seen = 0;
+        bool ok = parse_object([&](int index) {
+            seen |= 1u << index;
+            switch (fields[index].id) {
+                case field_id::messages:
+                    // A batch that fails part-way is skipped whole, not kept half-decoded
+                    if (parse_messages(batch, message_count)) return true;
+                    message_count = 0;
+                    return false;
+                case field_id::batch_id: return parse_uint(batch.batch_id);
+                case field_id::compression_ratio: return parse_uint(batch.compression_ratio);
+                default: return parse_beacon_field(fields[index].id, beacon);
+            }
+        });
+
+        batch.messages.resize(message_count);
+        if (!ok) return frame_kind::malformed;
+        skip_whitespace();
+        if (p_ != end_) return frame_kind::malformed;
+
+        auto has = [seen](field_id id) { return (seen & (1u << static_cast<uint32_t>(id))) != 0; };
+        if (has(field_id::source_id) && has(field_id::message_type)) return frame_kind::beacon;
+        if (has(field_id::batch_id) && has(field_id::messages)) return frame_kind::batch;
+        return frame_kind::unknown;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+
+    static void reset(beacon_message& msg) {
+        msg.source_id = {};
+        msg.message_type = {};
+        msg.payload.clear();
+        msg.timestamp_ns = 0;
+        msg.sequence_number = 0;
+        msg.is_critical = false;
+        msg.simd_capability = 0;
+        msg.parse_time_us = 0.0;
+        msg.message_size = 0;
+    }
+
+    void skip_whitespace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (p_ >= end_ || *p_ != c) return false;
+        ++p_;
+        return true;
+    }
+
+    // Raw string contents between quotes; `escaped` reports whether decoding is needed
+    bool scan_string(std::string_view& text, bool& escaped) {
+        if (p_ >= end_ || *p_ != '"') return false;
+        const char* start = ++p_;
+        escaped = false;
+        while (true) {
+            const char* quote = static_cast<const char*>(std::memchr(p_, '"', end_ - p_));
+            if (!quote) return false;
+            const char* q = quote;
+            while (q > start && q[-1] == '\\') --q;
+            p_ = quote + 1;
+            if (q != quote) escaped = true;
+            if (((quote - q) & 1) == 0) {
+                text = std::string_view(start, quote - start);
+                if (!escaped) escaped = std::memchr(start, '\\', text.size()) != nullptr;
+                return true;
+            }
+        }
+    }
+
+    bool parse_string(std::string& out) {
+        skip_whitespace();
+        std::string_view text;
+        bool escaped;
+        if (!scan_string(text, escaped)) return false;
+        if (!escaped) {
+            out.assign(text);
+            return true;
+        }
+        unescape(text, out);
+        return true;
+    }
+
+    // Interned fields are looked up straight from the buffer unless escaped
+    bool parse_string(symbol& out) {
+        skip_whitespace();
+        std::string_view text;
+        bool escaped;
+        if (!scan_string(text, escaped)) return false;
+        if (!escaped) {
+            out = symbol(text);
+            return true;
+        }
+        static thread_local std::string scratch;
+        unescape(text, scratch);
+        out = symbol(scratch);
+        return true;
+    }
+
+    static void unescape(std::string_view text, std::string& out) {
+        out.clear();
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size()) {
+                switch (text[++i]) {
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    default: out += text[i]; break;
+                }
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    std::string_view number_token() {
+        skip_whitespace();
+        const char* start = p_;
+        while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || *p_ == '-' || *p_ == '+' ||
+               *p_ == '.' || *p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+        }
+        return std::string_view(start, p_ - start);
+    }
+
+    bool parse_double(double& out) {
+        std::string_view token = number_token();
+        auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), out);
+        return ec == std::errc() && end == token.data() + token.size();
+    }
+
+    // Integers parse exactly; exponent/fraction forms go through double like the
+    // DOM path. Negative or out-of-range values fail and the field stays defaulted.
+    template<typename T>
+    bool parse_uint(T& out) {
+        std::string_view token = number_token();
+        if (token.empty()) return false;
+        uint64_t value = 0;
+        auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (ec != std::errc() || end != token.data() + token.size()) {
+            double d = 0.0;
+            auto [dend, dec] = std::from_chars(token.data(), token.data() + token.size(), d);
+            if (dec != std::errc() || dend != token.data() + token.size()) return false;
+            if (!(d >= 0.0 && d < 0x1p64)) return false;
+            value = static_cast<uint64_t>(d);
+        }
+        if (value > std::numeric_limits<T>::max()) return false;
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    bool parse_bool(bool& out) {
+        skip_whitespace();
+        if (end_ - p_ >= 4 && std::memcmp(p_, "true", 4) == 0) {
+            p_ += 4;
+            out = true;
+            return true;
+        }
+        if (end_ - p_ >= 5 && std::memcmp(p_, "false", 5) == 0) {
+            p_ += 5;
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Generic fallback for fields outside the schema
+    bool skip_value(uint32_t depth = 0) {
+        skip_whitespace();
+        if (p_ >= end_ || depth > 64) return false;
+
+        char c = *p_;
+        if (c == '"') {
+            std::string_view text;
+            bool escaped;
+            return scan_string(text, escaped);
+        }
+        if (c == '{' || c == '[') {
+            char close = (c == '{') ? '}' : ']';
+            ++p_;
+            skip_whitespace();
+            if (p_ < end_ && *p_ == close) { ++p_; return true; }
+            while (true) {
+                if (c == '{') {
+                    skip_whitespace();
+                    std::string_view key;
+                    bool escaped;
+                    if (!scan_string(key, escaped) || !consume(':')) return false;
+                }
+                if (!skip_value(depth + 1)) return false;
+                skip_whitespace();
+                if (p_ >= end_) return false;
+                if (*p_ == close) { ++p_; return true; }
+                if (*p_ != ',') return false;
+                ++p_;
+            }
+        }
+        const char* start = p_;
+        while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || (*p_ >= 'a' && *p_ <= 'z') ||
+               *p_ == '-' || *p_ == '+' || *p_ == '.' || *p_ == 'E')) {
+            ++p_;
+        }
+        return p_ != start;
+    }
+
+    // Walks one object, handing every known key's table index to `on_field`
+    template<typename Fn>
+    bool parse_object(Fn&& on_field) {
+        if (!consume('{')) return false;
+        skip_whitespace();
+        if (p_ < end_ && *p_ == '}') { ++p_; return true; }
+
+        while (true) {
+            skip_whitespace();
+            std::string_view key;
+            bool escaped;
+            if (!scan_string(key, escaped) || !consume(':')) return false;
+
+            int index = escaped ? -1 : lookup_field(key);
+            if (index >= 0) {
+                const char* value_start = p_;
+                if (!on_field(index)) {
+                    // Type mismatch: leave the member defaulted and skip the value
+                    p_ = value_start;
+                    if (!skip_value()) return false;
+                }
+            } else if (!skip_value()) {
+                return false;
+            }
+
+            skip_whitespace();
+            if (p_ >= end_) return false;
+            if (*p_ == '}') { ++p_; return true; }
+            if (*p_ != ',') return false;
+            ++p_;
+        }
+    }
+
+    bool parse_beacon_field(field_id id, beacon_message& msg) {
+        switch (id) {
+            case field_id::source_id: return parse_string(msg.source_id);
+            case field_id::message_type: return parse_string(msg.message_type);
+            case field_id::timestamp_ns: return parse_uint(msg.timestamp_ns);
+            case field_id::payload: return parse_string(msg.payload);
+            case field_id::sequence_number: return parse_uint(msg.sequence_number);
+            case field_id::is_critical: return parse_bool(msg.is_critical);
+            case field_id::simd_capability: return parse_uint(msg.simd_capability);
+            case field_id::parse_time_us: return parse_double(msg.parse_time_us);
+            case field_id::message_size: return parse_uint(msg.message_size);
+            default: return false;
+        }
+    }
+
+    // Messages are decoded in place, reusing existing elements and their string capacity
+    bool parse_messages(batch_message& batch, size_t& count) {
+        count = 0;
+        if (!consume('[')) return false;
+        skip_whitespace();
+        if (p_ < end_ && *p_ == ']') { ++p_; return true; }
+
+        while (true) {
+            if (count == batch.messages.size()) batch.messages.emplace_back();
+            beacon_message& msg = batch.messages[count++];
+            reset(msg);
+
+            bool ok = parse_object([&](int index) {
+                return parse_beacon_field(fields[index].id, msg);
+            });
+            if (!ok) return false;
+
+            skip_whitespace();
+            if (p_ >= end_) return false;
+            if (*p_ == ']') { ++p_; return true; }
+            if (*p_ != ',') return false;
+            ++p_;
+        }
+    }
+};
+
+inline frame_kind decode(std::string_view frame, beacon_message& beacon, batch_message& batch) {
+    return decoder(frame).decode(beacon, batch);
+}
+
+} // namespace wire_decoder
+
+// Direct serializer producing the bytes of to_json().to_string() without
+// building a DOM: keys are pre-rendered literals, numbers go through to_chars
+// with the same %g/6-digit formatting the ostream path uses, and strings that
+// need no escaping are appended in one copy. The deliberate difference is that
+// integer fields are written exactly: six digits would round timestamp_ns to
+// the nearest 10^12 ns, and sequence numbers past 999999 to "1e+06", which
+// receivers would count as loss and duplicates.
+namespace wire_encoder {
+
+inline void append_number(std::string& out, double value) {
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+    out.append(digits, result.ptr);
+}
+
+inline void append_integer(std::string& out, uint64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+inline bool needs_escape(char c) {
+    return c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline void append_string(std::string& out, std::string_view str) {
+    out += '"';
+    size_t clean = 0;
+    while (clean < str.size() && !needs_escape(str[clean])) ++clean;
+    out.append(str.data(), clean);
+
+    for (size_t i = clean; i < str.size(); ++i) {
+        switch (str[i]) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: out += str[i]; break;
+        }
+    }
+    out += '"';
+}
+
+inline void serialize(const beacon_message& msg, std::string& out) {
+    out += "{\"source_id\":";
+    append_string(out, msg.source_id.view());
+    out += ",\"message_type\":";
+    append_string(out, msg.message_type.view());
+    out += ",\"timestamp_ns\":";
+    append_integer(out, msg.timestamp_ns);
+    out += ",\"payload\":";
+    append_string(out, msg.payload);
+    out += ",\"sequence_number\":";
+    append_integer(out, msg.sequence_number);
+    out += msg.is_critical ? ",\"is_critical\":true" : ",\"is_critical\":false";
+    out += ",\"simd_capability\":";
+    append_integer(out, msg.simd_capability);
+    out += ",\"parse_time_us\":";
+    append_number(out, msg.parse_time_us);
+    out += ",\"message_size\":";
+    append_integer(out, msg.message_size);
+    out += '}';
+}
+
+inline void serialize(const batch_message& batch, std::string& out) {
+    // An empty messages array was never pushed to, so the DOM renders it as null
+    if (batch.messages.empty()) {
+        out += "{\"messages\":null";
+    } else {
+        out += "{\"messages\":[";
+        for (size_t i = 0; i < batch.messages.size(); ++i) {
+            if (i > 0) out += ',';
+            serialize(batch.messages[i], out);
+        }
+        out += ']';
+    }
+    out += ",\"batch_id\":";
+    append_integer(out, batch.batch_id);
+    out += ",\"compression_ratio\":";
+    append_integer(out, batch.compression_ratio);
+    out += '}';
+}
+
+// A beacon rendered once with fixed-width slots for the fields that change
+// per send. Digits are written left-aligned and the rest of a slot is
+// blank-padded (whitespace after a JSON value is insignificant), so a patch
+// never moves any other byte. The payload's sequence slot also carries the
+// string's closing quote, which must follow the digits directly.
+class beacon_template {
+public:
+    void render(const beacon_message& prototype, std::string_view payload_prefix) {
+        bytes_.clear();
+        bytes_ += "{\"source_id\":";
+        append_string(bytes_, prototype.source_id.view());
+        bytes_ += ",\"message_type\":";
+        append_string(bytes_, prototype.message_type.view());
+        bytes_ += ",\"timestamp_ns\":";
+        timestamp_slot_ = reserve_slot(timestamp_width);
+        bytes_ += ",\"payload\":";
+        append_string(bytes_, payload_prefix);
+        bytes_.pop_back();
+        payload_sequence_slot_ = reserve_slot(sequence_width + 1);
+        bytes_ += ",\"sequence_number\":";
+        sequence_slot_ = reserve_slot(sequence_width);
+        bytes_ += ",\"is_critical\":";
+        critical_slot_ = reserve_slot(critical_width);
+        bytes_ += ",\"simd_capability\":";
+        append_integer(bytes_, prototype.simd_capability);
+        bytes_ += ",\"parse_time_us\":";
+        append_number(bytes_, prototype.parse_time_us);
+        bytes_ += ",\"message_size\":";
+        append_integer(bytes_, prototype.message_size);
+        bytes_ += '}';
+    }
+    
+    bool ready() const { return !bytes_.empty(); }
+    
+    // Rewrites the per-send fields in place and returns the finished datagram
+    std::string_view patch(uint64_t timestamp_ns, uint32_t sequence_number, bool is_critical) {
+        char* base = bytes_.data();
+        write_digits(base + timestamp_slot_, timestamp_width, timestamp_ns);
+        
+        char* payload_end = std::to_chars(base + payload_sequence_slot_, 
+                                          base + payload_sequence_slot_ + sequence_width, sequence_number).ptr;
+        *payload_end++ = '"';
+        std::memset(payload_end, ' ', base + payload_sequence_slot_ + sequence_width + 1 - payload_end);
+        
+        write_digits(base + sequence_slot_, sequence_width, sequence_number);
+        std::memcpy(base + critical_slot_, is_critical ? "true " : "false", critical_width);
+        return bytes_;
+    }
+    
+private:
+    static constexpr size_t timestamp_width = 20;   // UINT64_MAX
+    static constexpr size_t sequence_width = 10;    // UINT32_MAX
+    static constexpr size_t critical_width = 5;     // "false"
+    
+    std::string bytes_;
+    size_t timestamp_slot_ = 0;
+    size_t payload_sequence_slot_ = 0;
+    size_t sequence_slot_ = 0;
+    size_t critical_slot_ = 0;
+    
+    size_t reserve_slot(size_t width) {
+        size_t offset = bytes_.size();
+        bytes_.append(width, ' ');
+        return offset;
+    }
+    
+    static void write_digits(char* slot, size_t width, uint64_t value) {
+        char* end = std::to_chars(slot, slot + width, value).ptr;
+        std::memset(end, ' ', slot + width - end);
+    }
+};
+
+// Per-thread output buffer; capacity survives between sends
+inline std::string& thread_buffer() {
+    thread_local std::string buffer = [] {
+        std::string b;
+        b.reserve(65536);
+        return b;
+    }();
+    buffer.clear();
+    return buffer;
+}
+
+} // namespace wire_encoder
+
+// LZ4-style block codec for batch frames, primed with a dictionary of
+// typical beacon JSON so even the first message of a batch finds its keys.
+// Envelope on the wire: [magic][u32 LE compressed size][u32 LE raw size][block].
+// The magic byte can never start a JSON frame, so receivers tell the two
+// apart from the first byte.
+namespace frame_codec {
+
+constexpr uint8_t compressed_magic = 0xFC;
+constexpr size_t header_size = 9;
+constexpr size_t max_raw_size = 1 << 20;    // Never inflate a frame past 1MB
+
+// Shared by every sender and receiver; changing it needs a new magic byte
+inline constexpr std::string_view dictionary =
+    "{\"messages\":[{\"source_id\":\"whispr-lighthouse-v3\",\"message_type\":\"heartbeat\","
+    "\"timestamp_ns\":1.76e+18,\"payload\":\"Lighthouse V3 - SIMD:64 Seq:1\",\"sequence_number\":1,"
+    "\"is_critical\":false,\"simd_capability\":64,\"parse_time_us\":0,\"message_size\":0},"
+    "{\"source_id\":\"whispr-lighthouse-v3\",\"message_type\":\"critical\",\"timestamp_ns\":1.76e+18,"
+    "\"payload\":\"Lighthouse V3 - SIMD:256 Seq:10\",\"sequence_number\":10,\"is_critical\":true,"
+    "\"simd_capability\":256,\"parse_time_us\":0,\"message_size\":0}],\"batch_id\":1,\"compression_ratio\":100}";
+
+constexpr int hash_bits = 12;
+constexpr size_t min_match = 4;
+constexpr size_t max_offset = 65535;
+constexpr size_t last_literals = 5;     // Block must end in literals
+constexpr size_t match_margin = 12;     // No match may start this close to the end
+
+inline uint32_t hash4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+inline void put_u32(std::string& out, size_t at, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[at + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+inline uint32_t get_u32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void put_length(std::string& out, size_t length) {
+    while (length >= 255) {
+        out += static_cast<char>(255);
+        length -= 255;
+    }
+    out += static_cast<char>(length);
+}
+
+inline void emit_sequence(std::string& out, const uint8_t* literals, size_t literal_length,
+                          size_t offset, size_t match_length) {
+    size_t match_code = match_length ? match_length - min_match : 0;
+    out += static_cast<char>((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15));
+    if (literal_length >= 15) put_length(out, literal_length - 15);
+    out.append(reinterpret_cast<const char*>(literals), literal_length);
+    
+    if (match_length == 0) return;
+    out += static_cast<char>(offset & 0xFF);
+    out += static_cast<char>(offset >> 8);
+    if (match_code >= 15) put_length(out, match_code - 15);
+}
+
+// Appends the envelope for raw to out. Returns false, leaving out untouched,
+// when the frame would not get smaller.
+inline bool compress(std::string_view raw, std::string& out) {
+    if (raw.size() < match_margin || raw.size() > max_raw_size) return false;
+    
+    // The dictionary sits in front of the input so matches can reach back into it
+    thread_local std::string window;
+    window.assign(dictionary);
+    window.append(raw);
+    
+    static const std::vector<uint32_t> primed_table = [] {
+        std::vector<uint32_t> table(1 << hash_bits, 0);
+        auto base = reinterpret_cast<const uint8_t*>(dictionary.data());
+        for (size_t i = 0; i + min_match <= dictionary.size(); ++i) {
+            table[hash4(base + i)] = static_cast<uint32_t>(i);
+        }
+        return table;
+    }();
+    thread_local std::vector<uint32_t> table;
+    table = primed_table;
+    
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(window.data());
+    const size_t start = dictionary.size();
+    const size_t end = window.size();
+    const size_t match_limit = end - match_margin;
+    const size_t extend_limit = end - last_literals;
+    
+    size_t out_start = out.size();
+    out += static_cast<char>(compressed_magic);
+    out.append(header_size - 1, '\0');
+    
+    size_t anchor = start;
+    size_t ip = start;
+    while (ip < match_limit) {
+        uint32_t h = hash4(base + ip);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(ip);
+        
+        if (candidate >= ip || ip - candidate > max_offset || 
+            std::memcmp(base + candidate, base + ip, min_match) != 0) {
+            ++ip;
+            continue;
+        }
+        
+        size_t length = min_match;
+        while (ip + length < extend_limit && base[candidate + length] == base[ip + length]) ++length;
+        
+        emit_sequence(out, base + anchor, ip - anchor, ip - candidate, length);
+        ip += length;
+        anchor = ip;
+        
+        if (ip < match_limit) table[hash4(base + ip - 2)] = static_cast<uint32_t>(ip - 2);
+    }
+    emit_sequence(out, base + anchor, end - anchor, 0, 0);
+    
+    size_t compressed = out.size() - out_start - header_size;
+    if (compressed >= raw.size()) {
+        out.resize(out_start);
+        return false;
+    }
+    
+    put_u32(out, out_start + 1, static_cast<uint32_t>(compressed));
+    put_u32(out, out_start + 5, static_cast<uint32_t>(raw.size()));
+    return true;
+}
+
+// Size of the envelope starting at frame, 0 if more bytes are needed, or
+// SIZE_MAX if the header is not a valid envelope
+inline size_t envelope_size(std::string_view frame) {
+    if (frame.empty()) return 0;
+    if (static_cast<uint8_t>(frame[0]) != compressed_magic) return SIZE_MAX;
+    if (frame.size() < header_size) return 0;
+    
+    auto header = reinterpret_cast<const uint8_t*>(frame.data());
+    uint32_t compressed = get_u32(header + 1);
+    uint32_t raw = get_u32(header + 5);
+    if (compressed == 0 || compressed > max_raw_size || raw > max_raw_size) return SIZE_MAX;
+    return header_size + compressed;
+}
+
+// Inflates an envelope into buffer, which is reused between calls and keeps
+// the dictionary as its prefix. Every length and offset is checked: the
+// input comes straight off the network.
+inline bool decompress(std::string_view envelope, std::string& buffer, std::string_view& raw) {
+    size_t total = envelope_size(envelope);
+    if (total == 0 || total == SIZE_MAX || total != envelope.size()) return false;
+    
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(envelope.data()) + header_size;
+    const uint8_t* const iend = reinterpret_cast<const uint8_t*>(envelope.data()) + envelope.size();
+    size_t raw_size = get_u32(reinterpret_cast<const uint8_t*>(envelope.data()) + 5);
+    
+    buffer.resize(dictionary.size() + raw_size);
+    std::memcpy(buffer.data(), dictionary.data(), dictionary.size());
+    
+    uint8_t* const window = reinterpret_cast<uint8_t*>(buffer.data());
+    uint8_t* op = window + dictionary.size();
+    uint8_t* const oend = op + raw_size;
+    
+    auto read_length = [&](size_t& length) {
+        uint8_t more;
+        do {
+            if (ip >= iend) return false;
+            more = *ip++;
+            length += more;
+            if (length > max_raw_size) return false;
+        } while (more == 255);
+        return true;
+    };
+    
+    while (true) {
+        if (ip >= iend) return false;
+        uint8_t token = *ip++;
+        
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(literal_length)) return false;
+        if (literal_length > size_t(iend - ip) || literal_length > size_t(oend - op)) return false;
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        
+        if (ip == iend) break;
+        
+        if (iend - ip < 2) return false;
+        size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > size_t(op - window)) return false;
+        
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length(match_length)) return false;
+        match_length += min_match;
+        if (match_length > size_t(oend - op)) return false;
+        
+        // Byte by byte: a match may overlap the bytes it is producing
+        const uint8_t* match = op - offset;
+        for (size_t i = 0; i < match_length; ++i) op[i] = match[i];
+        op += match_length;
+    }
+    
+    if (op != oend) return false;
+    raw = std::string_view(buffer.data() + dictionary.size(), raw_size);
+    return true;
+}
+
+} // namespace frame_codec
+
+// Compact binary encoding for links between our own nodes. A frame is
+// [magic][version][record][u32 LE body size][body]; integers in the body are
+// LEB128 varints except the timestamp and parse time, which are fixed 8-byte
+// little-endian, and strings are varint length-prefixed. The magic byte can
+// never start a JSON frame or a compressed envelope.
+namespace binary_wire {
+
+constexpr uint8_t magic = 0xB1;
+constexpr uint8_t version = 1;
+constexpr size_t header_size = 7;
+constexpr size_t max_body_size = 1 << 20;
+
+// Smallest body put_body can write: three empty strings, the two fixed 8-byte
+// fields, the flag byte and three one-byte varints
+constexpr size_t min_beacon_size = 3 + 2 * 8 + 1 + 3;
+
+enum class record : uint8_t { beacon = 1, batch = 2, hello = 3 };
+
+inline void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void put_fixed64(std::string& out, uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    out.append(bytes, 8);
+}
+
+inline void put_string(std::string& out, std::string_view str) {
+    put_varint(out, str.size());
+    out.append(str);
+}
+
+inline void put_body(std::string& out, const beacon_message& msg) {
+    put_string(out, msg.source_id.view());
+    put_string(out, msg.message_type.view());
+    put_fixed64(out, msg.timestamp_ns);
+    put_string(out, msg.payload);
+    put_varint(out, msg.sequence_number);
+    out += static_cast<char>(msg.is_critical ? 1 : 0);
+    put_varint(out, msg.simd_capability);
+    put_fixed64(out, std::bit_cast<uint64_t>(msg.parse_time_us));
+    put_varint(out, msg.message_size);
+}
+
+inline size_t begin_frame(std::string& out, record kind) {
+    size_t start = out.size();
+    out += static_cast<char>(magic);
+    out += static_cast<char>(version);
+    out += static_cast<char>(kind);
+    out.append(4, '\0');
+    return start;
+}
+
+inline void end_frame(std::string& out, size_t start) {
+    uint32_t body = static_cast<uint32_t>(out.size() - start - header_size);
+    for (int i = 0; i < 4; ++i) out[start + 3 + i] = static_cast<char>((body >> (8 * i)) & 0xFF);
+}
+
+// Appends one frame to out, like wire_encoder::serialize
+inline void serialize(const beacon_message& msg, std::string& out) {
+    size_t start = begin_frame(out, record::beacon);
+    put_body(out, msg);
+    end_frame(out, start);
+}
+
+inline void serialize(const batch_message& batch, std::string& out) {
+    size_t start = begin_frame(out, record::batch);
+    put_varint(out, batch.batch_id);
+    put_varint(out, batch.compression_ratio);
+    put_varint(out, batch.messages.size());
+    for (const auto& msg : batch.messages) put_body(out, msg);
+    end_frame(out, start);
+}
+
+// Optional opening frames on a TCP connection: the client lists the versions
+// it can send, and the listener answers with a hello holding the one to use,
+// or an empty list when they share none and the client should send JSON
+inline void serialize_hello(std::string& out, std::initializer_list<uint8_t> versions) {
+    size_t start = begin_frame(out, record::hello);
+    put_varint(out, versions.size());
+    for (uint8_t offered : versions) put_varint(out, offered);
+    end_frame(out, start);
+}
+
+// Size of the frame starting at data, 0 if more bytes are needed, or
+// SIZE_MAX if the header is not one this build can read
+inline size_t frame_size(std::string_view data) {
+    if (data.empty()) return 0;
+    if (static_cast<uint8_t>(data[0]) != magic) return SIZE_MAX;
+    if (data.size() < header_size) return 0;
+    if (static_cast<uint8_t>(data[1]) != version) return SIZE_MAX;
+    
+    auto p = reinterpret_cast<const uint8_t*>(data.data()) + 3;
+    uint32_t body = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    if (body > max_body_size) return SIZE_MAX;
+    return header_size + body;
+}
+
+// Bounds-checked reader over one frame body
+class reader {
+public:
+    explicit reader(std::string_view body) 
+        : pos_(reinterpret_cast<const uint8_t*>(body.data())), end_(pos_ + body.size()) {}
+    
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos_ == end_) return false;
+            uint8_t byte = *pos_++;
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+    
+    template<typename T>
+    bool varint_as(T& value) {
+        uint64_t wide;
+        if (!varint(wide) || wide > std::numeric_limits<T>::max()) return false;
+        value = static_cast<T>(wide);
+        return true;
+    }
+    
+    bool fixed64(uint64_t& value) {
+        if (end_ - pos_ < 8) return false;
+        value = 0;
+        for (int i = 0; i < 8; ++i) value |= uint64_t(pos_[i]) << (8 * i);
+        pos_ += 8;
+        return true;
+    }
+    
+    // Assigns into the existing string so steady-state decoding reuses its capacity
+    bool string(std::string& out) {
+        uint64_t length;
+        if (!varint(length) || length > size_t(end_ - pos_)) return false;
+        out.assign(reinterpret_cast<const char*>(pos_), length);
+        pos_ += length;
+        return true;
+    }
+    
+    bool string(symbol& out) {
+        uint64_t length;
+        if (!varint(length) || length > size_t(end_ - pos_)) return false;
+        out = symbol(std::string_view(reinterpret_cast<const char*>(pos_), length));
+        pos_ += length;
+        return true;
+    }
+    
+    bool byte(uint8_t& value) {
+        if (pos_ == end_) return false;
+        value = *pos_++;
+        return true;
+    }
+    
+    bool beacon(beacon_message& msg) {
+        uint8_t flags;
+        uint64_t parse_bits;
+        if (!string(msg.source_id) || !string(msg.message_type) || !fixed64(msg.timestamp_ns) ||
+            !string(msg.payload) || !varint_as(msg.sequence_number) || !byte(flags) || 
+            !varint_as(msg.simd_capability) || !fixed64(parse_bits) || !varint_as(msg.message_size)) {
+            return false;
+        }
+        msg.is_critical = (flags & 1) != 0;
+        msg.parse_time_us = std::bit_cast<double>(parse_bits);
+        return true;
+    }
+    
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+    
+private:
+    const uint8_t* pos_;
+    const uint8_t* end_;
+};
+
+// Decodes a whole frame into the caller's reusable message objects
+inline wire_decoder::frame_kind decode(std::string_view frame, beacon_message& msg, batch_message& batch) {
+    using wire_decoder::frame_kind;
+    
+    size_t size = frame_size(frame);
+    if (size == SIZE_MAX) return frame_kind::unknown;
+    if (size == 0 || size != frame.size()) return frame_kind::malformed;
+    
+    reader in(frame.substr(header_size));
+    switch (static_cast<record>(static_cast<uint8_t>(frame[2]))) {
+        case record::beacon:
+            return in.beacon(msg) && in.remaining() == 0 ? frame_kind::beacon : frame_kind::malformed;
+            
+        case record::batch: {
+            uint64_t count;
+            if (!in.varint_as(batch.batch_id) || !in.varint(batch.compression_ratio) || 
+                !in.varint(count) || count > in.remaining() / min_beacon_size) {
+                return frame_kind::malformed;
+            }
+            // Shrinking keeps the surviving elements' string buffers for the next batch
+            batch.messages.resize(count);
+            for (auto& batch_msg : batch.messages) {
+                if (!in.beacon(batch_msg)) return frame_kind::malformed;
+            }
+            return in.remaining() == 0 ? frame_kind::batch : frame_kind::malformed;
+        }
+            
+        case record::hello:
+            break;      // Only meaningful as a connection's opening frame
+    }
+    return frame_kind::unknown;
+}
+
+// The version to answer a client's hello frame with: the newest one both
+// sides speak, 0 if there is none, or -1 if the frame is malformed
+inline int negotiate(std::string_view frame) {
+    size_t size = frame_size(frame);
+    if (size == SIZE_MAX || size != frame.size()) return -1;
+    if (static_cast<record>(static_cast<uint8_t>(frame[2])) != record::hello) return -1;
+    
+    reader in(frame.substr(header_size));
+    uint64_t count;
+    if (!in.varint(count)) return -1;
+    
+    int chosen = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t offered;
+        if (!in.varint(offered)) return -1;
+        if (offered == version) chosen = version;
+    }
+    return in.remaining() == 0 ? chosen : -1;
+}
+
+} // namespace binary_wire
+
+// Echo mode: a listener answers each UDP datagram that held beacons with one
+// fixed-size pong carrying the NTP timestamps for the newest beacon in it -
+// origin (the sender's timestamp_ns), receive and transmit (the listener's
+// clock). Integers are little-endian like binary_wire.
+namespace echo_wire {
+
+constexpr uint8_t magic = 0xB3;
+constexpr uint8_t version = 1;
+constexpr size_t pong_size = 32;
+
+struct pong {
+    uint64_t origin_ns;
+    uint64_t receive_ns;
+    uint64_t transmit_ns;
+};
+
+inline void encode(const pong& reply, char* out) {
+    std::memset(out, 0, 8);
+    out[0] = static_cast<char>(magic);
+    out[1] = static_cast<char>(version);
+    const uint64_t stamps[] = {reply.origin_ns, reply.receive_ns, reply.transmit_ns};
+    for (int s = 0; s < 3; ++s) {
+        for (int i = 0; i < 8; ++i) out[8 + 8 * s + i] = static_cast<char>((stamps[s] >> (8 * i)) & 0xFF);
+    }
+}
+
+inline bool decode(std::string_view data, pong& reply) {
+    if (data.size() != pong_size || static_cast<uint8_t>(data[0]) != magic ||
+        static_cast<uint8_t>(data[1]) != version) {
+        return false;
+    }
+    uint64_t* stamps[] = {&reply.origin_ns, &reply.receive_ns, &reply.transmit_ns};
+    for (int s = 0; s < 3; ++s) {
+        *stamps[s] = 0;
+        for (int i = 0; i < 8; ++i) *stamps[s] |= uint64_t(static_cast<uint8_t>(data[8 + 8 * s + i])) << (8 * i);
+    }
+    return true;
+}
+
+} // namespace echo_wire
+
+// Log-linear histogram of nanosecond values in the HdrHistogram layout:
+// 32 linear sub-buckets per power of two keep every value within ~3% of
+// its bucket. Each counter is a relaxed atomic with a single writer thread.
+class latency_histogram {
+public:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr int max_value_bits = 40;      // ~18 minutes; longer values are clamped
+    static constexpr size_t bucket_count = size_t(max_value_bits - sub_bucket_bits + 1) << sub_bucket_bits;
+    
+    static size_t bucket_of(uint64_t value) {
+        value = std::min<uint64_t>(value, (uint64_t(1) << max_value_bits) - 1);
+        if (value < (uint64_t(2) << sub_bucket_bits)) return static_cast<size_t>(value);
+        int shift = std::bit_width(value) - 1 - sub_bucket_bits;
+        return (size_t(shift + 1) << sub_bucket_bits) + static_cast<size_t>((value >> shift) - (uint64_t(1) << sub_bucket_bits));
+    }
+    
+    // Largest value that lands in bucket, which is what percentiles report
+    static uint64_t highest_in_bucket(size_t bucket) {
+        if (bucket < (size_t(2) << sub_bucket_bits)) return bucket;
+        int shift = static_cast<int>(bucket >> sub_bucket_bits) - 1;
+        uint64_t mantissa = (bucket & ((size_t(1) << sub_bucket_bits) - 1)) + (uint64_t(1) << sub_bucket_bits);
+        return ((mantissa + 1) << shift) - 1;
+    }
+    
+    void record(uint64_t value_ns) {
+        counts_[bucket_of(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void add_to(std::vector<uint64_t>& totals) const {
+        totals.resize(bucket_count);
+        for (size_t i = 0; i < bucket_count; ++i) totals[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> counts_{};
+};
+
+// Percentiles of one histogram, in microseconds
+struct latency_summary {
+    uint64_t count = 0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double p999_us = 0.0;
+    double max_us = 0.0;
+    
+    static latency_summary from_counts(const std::vector<uint64_t>& counts) {
+        latency_summary summary;
+        for (uint64_t c : counts) summary.count += c;
+        if (summary.count == 0) return summary;
+        
+        const double quantiles[] = {0.50, 0.90, 0.99, 0.999};
+        double* targets[] = {&summary.p50_us, &summary.p90_us, &summary.p99_us, &summary.p999_us};
+        size_t next = 0;
+        uint64_t seen = 0;
+        
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i] == 0) continue;
+            seen += counts[i];
+            double value_us = latency_histogram::highest_in_bucket(i) / 1000.0;
+            while (next < 4 && seen >= static_cast<uint64_t>(std::ceil(quantiles[next] * summary.count))) {
+                *targets[next++] = value_us;
+            }
+            summary.max_us = value_us;
+        }
+        return summary;
+    }
+};
+
+// Lifetime distribution plus the one over the recent window
+struct latency_view {
+    latency_summary lifetime;
+    latency_summary window;
+};
+
+struct network_stats {
+    uint64_t packets_sent = 0;
+    uint64_t packets_received = 0;
+    uint64_t bytes_transmitted = 0;
+    double avg_latency_ms = 0.0;
+    uint32_t active_connections = 0;
+    double min_parse_time_us = 0.0;
+    double max_parse_time_us = 0.0;
+    double avg_parse_time_us = 0.0;
+    uint64_t simd_operations_count = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    uint64_t queue_depth = 0;
+    uint64_t queue_dropped = 0;
+    uint64_t tx_syscalls = 0;
+    uint64_t tx_errors = 0;
+    bool tx_gso = false;
+    uint32_t ws_viewers = 0;
+    uint64_t ws_published = 0;
+    uint64_t ws_dropped = 0;
+    uint64_t shm_published = 0;
+    uint32_t sources_tracked = 0;
+    uint64_t sources_overflowed = 0;    // Beacons from sources the table had no room for
+    uint32_t strings_interned = 0;
+    uint64_t strings_overflowed = 0;    // Lookups the interner had no room for
+    uint64_t history_stored = 0;
+    uint64_t history_dropped = 0;
+    uint32_t history_segments = 0;
+    uint64_t echo_replies = 0;
+    
+    latency_view parse_time;        // Decode of one frame
+    latency_view queue_delay;       // Frame received to parse started
+    latency_view beacon_latency;    // Sender timestamp to parse, one way, uncorrected for clock offset
+    double window_seconds = 0.0;
+};
+
+// What a full queue does with a new item
+enum class overflow_policy { block, drop_newest, drop_oldest };
+
+// How beacons are encoded for a destination; JSON stays the public default
+enum class wire_format { json, binary };
+
+inline bool parse_wire_format(std::string_view name, wire_format& format) {
+    if (name == "json") format = wire_format::json;
+    else if (name == "binary") format = wire_format::binary;
+    else return false;
+    return true;
+}
+
+// Least severe record the async logger lets through
+enum class log_level { debug, info, warn, error };
+
+inline bool parse_log_level(std::string_view name, log_level& level) {
+    if (name == "debug") level = log_level::debug;
+    else if (name == "info") level = log_level::info;
+    else if (name == "warn") level = log_level::warn;
+    else if (name == "error") level = log_level::error;
+    else return false;
+    return true;
+}
+
+struct monitor_config {
+    std::string target_host;
+    uint16_t target_port;
+    std::vector<std::string> destinations;  // Overrides target_host/target_port when set
+    uint16_t listen_port;
+    uint32_t beacon_interval_ms;
+    uint32_t max_concurrent_connections;
+    bool enable_compression;
+    bool enable_encryption;
+    uint32_t batch_size;
+    bool enable_simd_validation;
+    bool enable_prefetch;
+    uint32_t parse_threads;
+    uint32_t queue_capacity = 65536;
+    overflow_policy queue_overflow = overflow_policy::block;
+    uint32_t io_threads = 2;
+    uint32_t listener_shards = 0;
+    uint16_t udp_listen_port = 9001;
+    uint32_t batch_linger_us = 10000;
+    bool beacon_templates = false;
+    wire_format beacon_wire = wire_format::json;
+    log_level min_log_level = log_level::info;
+    uint32_t log_sample_tx = 1;     // Log 1 in N sent beacons/batches
+    uint32_t log_sample_rx = 1;     // Log 1 in N received beacons/batches
+    uint16_t ws_port = 8083;        // Browser feed, 0 disables
+    uint32_t ws_client_queue = 256; // Frames held for a slow viewer before the oldest go
+    std::string shm_name;           // Shared-memory beacon ring, empty disables
+    uint32_t shm_records = 65536;
+    uint32_t max_sources = 131072;  // Distinct source_ids tracked
+    std::string history_dir;        // Beacon history segments, empty disables
+    uint32_t history_segment_mb = 64;
+    uint64_t history_segment_age_us = 3600000000ULL;
+    uint64_t history_retention_us = 7 * 86400000000ULL;
+    bool echo_replies = false;      // Listener pongs UDP beacons; beacon estimates RTT and clock offset
+};
+
+struct performance_counters {
+    std::atomic<uint64_t> simd_string_ops{0};
+    std::atomic<uint64_t> simd_number_ops{0};
+    std::atomic<uint64_t> allocations_saved{0};
+    std::atomic<uint64_t> branch_predictions_saved{0};
+    
+    void reset() {
+        simd_string_ops = 0;
+        simd_number_ops = 0;
+        allocations_saved = 0;
+        branch_predictions_saved = 0;
+    }
+};
+
+// Listener counters for one writer thread, alone on its cache line
+struct alignas(64) stats_shard {
+    std::atomic<uint64_t> packets_received{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> parses{0};
+    std::atomic<double> total_parse_time_us{0.0};
+    std::atomic<double> min_parse_time_us{0.0};
+    std::atomic<double> max_parse_time_us{0.0};
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> cache_misses{0};
+    std::atomic<int64_t> active_connections{0};
+    
+    latency_histogram parse_time;
+    latency_histogram queue_delay;
+    latency_histogram beacon_latency;
+    
+    void record_parse(double parse_us) {
+        parse_time.record(static_cast<uint64_t>(parse_us * 1000.0));
+        parses.fetch_add(1, std::memory_order_relaxed);
+        total_parse_time_us.fetch_add(parse_us, std::memory_order_relaxed);
+        
+        double seen = min_parse_time_us.load(std::memory_order_relaxed);
+        while ((seen == 0.0 || parse_us < seen) && 
+               !min_parse_time_us.compare_exchange_weak(seen, parse_us, std::memory_order_relaxed)) {}
+        seen = max_parse_time_us.load(std::memory_order_relaxed);
+        while (parse_us > seen && 
+               !max_parse_time_us.compare_exchange_weak(seen, parse_us, std::memory_order_relaxed)) {}
+        
+        if (parse_us < 10.0) {
+            cache_hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            cache_misses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    // A sender clock ahead of ours gives no usable one-way figure
+    void record_latency(uint64_t sent_ns, uint64_t received_ns) {
+        if (received_ns >= sent_ns) beacon_latency.record(received_ns - sent_ns);
+    }
+};
+
+// A fixed set of stats shards. Each thread is handed one on first use and
+// writes only that; readers sum them all. More threads than shards share
+// slots, which stays exact because every update is an atomic RMW - only
+// the cache line stops being private.
+//
+// Histogram windows are computed on the read side: lifetime totals are
+// snapshotted at most once a second, and the window is the latest totals
+// minus the oldest snapshot still inside it. Writers never reset anything.
+class sharded_stats {
+public:
+    static constexpr size_t shard_count = 64;
+    static constexpr auto window_length = std::chrono::seconds(10);
+    
+    sharded_stats() {
+        // An empty baseline, so the first read already has a window
+        std::vector<uint64_t> zeros(latency_histogram::bucket_count, 0);
+        history_.push_back({std::chrono::steady_clock::now(), zeros, zeros, zeros});
+    }
+    
+    stats_shard& local() {
+        thread_local const size_t slot = next_slot_.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return shards_[slot];
+    }
+    
+    void collect(network_stats& into, uint64_t& parses, double& parse_time_us) const {
+        int64_t connections = 0;
+        for (const auto& shard : shards_) {
+            into.packets_received += shard.packets_received.load(std::memory_order_relaxed);
+            into.bytes_transmitted += shard.bytes_received.load(std::memory_order_relaxed);
+            into.cache_hits += shard.cache_hits.load(std::memory_order_relaxed);
+            into.cache_misses += shard.cache_misses.load(std::memory_order_relaxed);
+            connections += shard.active_connections.load(std::memory_order_relaxed);
+            
+            parses += shard.parses.load(std::memory_order_relaxed);
+            parse_time_us += shard.total_parse_time_us.load(std::memory_order_relaxed);
+            
+            double shard_min = shard.min_parse_time_us.load(std::memory_order_relaxed);
+            double shard_max = shard.max_parse_time_us.load(std::memory_order_relaxed);
+            if (shard_min > 0.0 && (into.min_parse_time_us == 0.0 || shard_min < into.min_parse_time_us)) {
+                into.min_parse_time_us = shard_min;
+            }
+            into.max_parse_time_us = std::max(into.max_parse_time_us, shard_max);
+        }
+        into.active_connections = static_cast<uint32_t>(std::max<int64_t>(connections, 0));
+        
+        collect_latency(into);
+    }
+    
+private:
+    struct latency_totals {
+        std::chrono::steady_clock::time_point at;
+        std::vector<uint64_t> parse_time, queue_delay, beacon_latency;
+    };
+    
+    void collect_latency(network_stats& into) const {
+        latency_totals now{std::chrono::steady_clock::now(), {}, {}, {}};
+        now.parse_time.assign(latency_histogram::bucket_count, 0);
+        now.queue_delay.assign(latency_histogram::bucket_count, 0);
+        now.beacon_latency.assign(latency_histogram::bucket_count, 0);
+        
+        for (const auto& shard : shards_) {
+            // Every histogram sample comes with a parse; idle slots are skipped
+            if (shard.parses.load(std::memory_order_relaxed) == 0) continue;
+            shard.parse_time.add_to(now.parse_time);
+            shard.queue_delay.add_to(now.queue_delay);
+            shard.beacon_latency.add_to(now.beacon_latency);
+        }
+        
+        std::lock_guard<std::mutex> lock(window_mutex_);
+        if (now.at - history_.back().at >= std::chrono::seconds(1)) {
+            history_.push_back(now);
+        }
+        while (history_.size() > 1 && now.at - history_[1].at >= window_length) history_.pop_front();
+        const latency_totals& base = history_.front();
+        
+        auto window_of = [](const std::vector<uint64_t>& current, const std::vector<uint64_t>& earlier) {
+            std::vector<uint64_t> delta(current.size());
+            for (size_t i = 0; i < current.size(); ++i) delta[i] = current[i] - earlier[i];
+            return latency_summary::from_counts(delta);
+        };
+        
+        into.parse_time = {latency_summary::from_counts(now.parse_time), window_of(now.parse_time, base.parse_time)};
+        into.queue_delay = {latency_summary::from_counts(now.queue_delay), window_of(now.queue_delay, base.queue_delay)};
+        into.beacon_latency = {latency_summary::from_counts(now.beacon_latency), 
+                               window_of(now.beacon_latency, base.beacon_latency)};
+        into.window_seconds = std::chrono::duration<double>(now.at - base.at).count();
+    }
+    
+    std::array<stats_shard, shard_count> shards_;
+    mutable std::mutex window_mutex_;
+    mutable std::deque<latency_totals> history_;
+    static inline std::atomic<size_t> next_slot_{0};
+};
+
+// Parks consumers of a lock-free queue without taxing its producers: a
+// notify is a fence and one load unless a consumer is actually asleep.
+// Consumers announce themselves with prepare_wait(), re-check the queue,
+// then sleep on a futex (std::atomic::wait elsewhere) until the epoch moves.
+class event_count {
+public:
+    uint32_t prepare_wait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+    
+    void cancel_wait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+    
+    void wait(uint32_t key) {
+        while (epoch_.load(std::memory_order_acquire) == key) {
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+#else
+            epoch_.wait(key, std::memory_order_acquire);
+#endif
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    
+    void notify_one() { notify(false); }
+    void notify_all() { notify(true); }
+    
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+    
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    alignas(64) std::atomic<uint32_t> waiters_{0};
+    
+    void notify(bool all) {
+        // Pairs with prepare_wait: either the waiter sees the new item or we see the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) == 0) return;
+        
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, 
+                all ? std::numeric_limits<int>::max() : 1, nullptr, nullptr, 0);
+#else
+        if (all) epoch_.notify_all(); else epoch_.notify_one();
+#endif
+    }
+};
+
+inline void cpu_relax() {
+#if defined(__AVX2__) || defined(__SSE2__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Hot-path log lines as fixed-size binary records. Each producer thread
+// owns a single-producer ring; one background thread drains every ring,
+// formats the records and writes them in one block per pass. A full ring
+// drops the record and counts it rather than stall the producer.
+enum class log_event : uint8_t { beacon_sent, batch_sent, beacon_received, batch_received, critical_in_batch };
+
+struct log_record {
+    log_event event;
+    bool critical;
+    bool fanout;                // Sender has several destinations
+    uint32_t thread_id;
+    uint32_t delivered;
+    uint32_t targets;
+    uint64_t time_ns;           // system_clock, formatted by the writer
+    uint64_t id;                // Sequence or batch number
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t compression_ratio;
+    double time_us;             // Parse or serialize time
+    double latency_ms;
+    char peer[46];
+    char label[18];
+    
+    void set_peer(std::string_view ip) { copy_text(peer, sizeof(peer), ip); }
+    void set_label(std::string_view text) { copy_text(label, sizeof(label), text); }
+    
+private:
+    static void copy_text(char* to, size_t capacity, std::string_view text) {
+        size_t n = std::min(text.size(), capacity - 1);
+        std::memcpy(to, text.data(), n);
+        to[n] = '\0';
+    }
+};
+
+class async_logger {
+public:
+    static constexpr size_t ring_capacity = 1024;   // Records per producer thread
+    
+    struct counters {
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        uint64_t sampled_out = 0;
+    };
+    
+    static async_logger& instance() {
+        static async_logger logger;
+        return logger;
+    }
+    
+    void configure(log_level level, uint32_t sample_tx, uint32_t sample_rx) {
+        level_.store(level, std::memory_order_relaxed);
+        sample_every_[0].store(std::max<uint32_t>(sample_tx, 1), std::memory_order_relaxed);
+        sample_every_[1].store(std::max<uint32_t>(sample_rx, 1), std::memory_order_relaxed);
+    }
+    
+    bool enabled(log_level level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+    
+    // Slot for the calling thread's next record, or null when the record is
+    // filtered, sampled out or the ring is full. Finish with commit().
+    log_record* begin(log_event event, log_level level) {
+        if (!enabled(level)) return nullptr;
+        
+        ring& r = local_ring();
+        int category = category_of(event);
+        if (category >= 0) {
+            uint32_t every = sample_every_[category].load(std::memory_order_relaxed);
+            if (every > 1 && r.sample_tick[category]++ % every != 0) {
+                r.sampled_out.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        
+        uint64_t head = r.head.load(std::memory_order_relaxed);
+        if (head - r.tail.load(std::memory_order_acquire) >= ring_capacity) {
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        
+        log_record* record = &r.records[head % ring_capacity];
+        record->event = event;
+        record->time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return record;
+    }
+    
+    void commit() {
+        ring& r = local_ring();
+        r.head.store(r.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        pending_.notify_one();
+    }
+    
+    // Writes out everything queued so far; for callers about to print directly
+    void flush() {
+        drain();
+    }
+    
+    counters stats() const {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        counters total = retired_;
+        for (const auto& r : rings_) {
+            total.written += r->written.load(std::memory_order_relaxed);
+            total.dropped += r->dropped.load(std::memory_order_relaxed);
+            total.sampled_out += r->sampled_out.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    
+    ~async_logger() {
+        running_.store(false);
+        pending_.notify_all();
+        if (writer_.joinable()) writer_.join();
+        drain();
+    }
+    
+private:
+    struct ring {
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        alignas(64) std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> sampled_out{0};
+        std::atomic<bool> retired{false};
+        uint32_t sample_tick[2] = {0, 0};
+        std::array<log_record, ring_capacity> records;
+    };
+    
+    // Marks the ring retired when its thread exits; the writer frees it once drained
+    struct ring_handle {
+        std::shared_ptr<ring> owned;
+        ~ring_handle() { if (owned) owned->retired.store(true, std::memory_order_release); }
+    };
+    
+    std::atomic<log_level> level_{log_level::info};
+    std::atomic<uint32_t> sample_every_[2] = {1, 1};     // tx, rx
+    
+    mutable std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<ring>> rings_;
+    counters retired_;
+    
+    std::mutex drain_mutex_;
+    std::string output_;
+    time_t cached_second_ = -1;
+    char cached_clock_[16] = {};
+    
+    std::atomic<bool> running_{true};
+    event_count pending_;
+    std::thread writer_;
+    
+    async_logger() {
+        writer_ = std::thread([this]() {
+            while (running_.load()) {
+                if (drain() > 0) continue;
+                
+                // Park until a producer commits; the re-drain closes the race
+                uint32_t key = pending_.prepare_wait();
+                if (drain() > 0 || !running_.load()) {
+                    pending_.cancel_wait();
+                } else {
+                    pending_.wait(key);
+                }
+            }
+        });
+    }
+    
+    static int category_of(log_event event) {
+        switch (event) {
+            case log_event::beacon_sent:
+            case log_event::batch_sent: return 0;
+            case log_event::beacon_received:
+            case log_event::batch_received: return 1;
+            default: return -1;     // Never sampled
+        }
+    }
+    
+    ring& local_ring() {
+        thread_local ring_handle handle;
+        if (!handle.owned) {
+            handle.owned = std::make_shared<ring>();
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(handle.owned);
+        }
+        return *handle.owned;
+    }
+    
+    size_t drain() {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+        
+        std::vector<std::shared_ptr<ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings = rings_;
+        }
+        
+        size_t drained = 0;
+        output_.clear();
+        for (auto& r : rings) {
+            uint64_t tail = r->tail.load(std::memory_order_relaxed);
+            uint64_t head = r->head.load(std::memory_order_acquire);
+            if (tail == head) continue;
+            
+            for (uint64_t i = tail; i != head; ++i) format_record(r->records[i % ring_capacity]);
+            r->tail.store(head, std::memory_order_release);
+            r->written.fetch_add(head - tail, std::memory_order_relaxed);
+            drained += head - tail;
+        }
+        
+        if (!output_.empty()) {
+            std::cout.write(output_.data(), static_cast<std::streamsize>(output_.size()));
+            std::cout.flush();
+        }
+        
+        // Drop rings whose threads are gone once nothing is left in them
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        std::erase_if(rings_, [this](const std::shared_ptr<ring>& r) {
+            if (!r->retired.load(std::memory_order_acquire) || 
+                r->head.load(std::memory_order_acquire) != r->tail.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            retired_.written += r->written.load(std::memory_order_relaxed);
+            retired_.dropped += r->dropped.load(std::memory_order_relaxed);
+            retired_.sampled_out += r->sampled_out.load(std::memory_order_relaxed);
+            return true;
+        });
+        return drained;
+    }
+    
+    void append_timestamp(uint64_t time_ns) {
+        time_t seconds = static_cast<time_t>(time_ns / 1000000000ULL);
+        if (seconds != cached_second_) {
+            std::strftime(cached_clock_, sizeof(cached_clock_), "%H:%M:%S", std::localtime(&seconds));
+            cached_second_ = seconds;
+        }
+        char millis[8];
+        std::snprintf(millis, sizeof(millis), ".%03u", static_cast<unsigned>((time_ns / 1000000ULL) % 1000));
+        output_ += '[';
+        output_ += cached_clock_;
+        output_ += millis;
+        output_ += "] ";
+    }
+    
+    void append(uint64_t value) { wire_encoder::append_integer(output_, value); }
+    void append(double value) { wire_encoder::append_number(output_, value); }
+    
+    void format_record(const log_record& r) {
+        std::string& out = output_;
+        switch (r.event) {
+            case log_event::beacon_sent:
+            case log_event::batch_sent: {
+                bool batch = r.event == log_event::batch_sent;
+                out += batch ? ansi::BRIGHT_MAGENTA : ansi::BRIGHT_BLUE;
+                append_timestamp(r.time_ns);
+                if (batch) {
+                    out += ansi::FIRE;
+                    out += " Batch #";
+                    append(r.id);
+                    out += " sent (";
+                    append(r.messages);
+                    out += " messages, ";
+                } else {
+                    out += ansi::GREEN;
+                    out += ansi::ROCKET;
+                    out += " Beacon #";
+                    append(r.id);
+                    out += " sent (";
+                }
+                append(r.bytes);
+                out += " bytes, ";
+                append(static_cast<uint64_t>(r.time_us));
+                out += "μs serialize";
+                if (batch) {
+                    out += ", ";
+                    append(r.compression_ratio);
+                    out += "% compression";
+                }
+                if (r.fanout) {
+                    out += ", ";
+                    append(uint64_t(r.delivered));
+                    out += '/';
+                    append(uint64_t(r.targets));
+                    out += " destinations";
+                }
+                out += ')';
+                break;
+            }
+            
+            case log_event::beacon_received:
+                out += ansi::BRIGHT_CYAN;
+                append_timestamp(r.time_ns);
+                out += "[Thread ";
+                append(uint64_t(r.thread_id));
+                out += "] [";
+                out += ansi::BRIGHT_WHITE;
+                out += r.peer;
+                out += ansi::BRIGHT_CYAN;
+                out += "] ";
+                out += ansi::SPARKLE;
+                out += " Beacon #";
+                append(r.id);
+                out += " (Type: ";
+                out += ansi::YELLOW;
+                out += r.label;
+                out += ansi::BRIGHT_CYAN;
+                out += ", Critical: ";
+                out += r.critical ? ansi::BRIGHT_RED : ansi::GREEN;
+                out += r.critical ? "YES" : "NO";
+                out += ansi::BRIGHT_CYAN;
+                out += ", Parse: ";
+                out += ansi::WHITE;
+                append(r.time_us);
+                out += "μs";
+                out += ansi::BRIGHT_CYAN;
+                out += ", Latency: ";
+                out += ansi::WHITE;
+                append(r.latency_ms);
+                out += "ms";
+                out += ansi::BRIGHT_CYAN;
+                out += ')';
+                break;
+                
+            case log_event::batch_received:
+                out += ansi::BRIGHT_MAGENTA;
+                append_timestamp(r.time_ns);
+                out += "[Thread ";
+                append(uint64_t(r.thread_id));
+                out += "] [";
+                out += ansi::BRIGHT_WHITE;
+                out += r.peer;
+                out += ansi::BRIGHT_MAGENTA;
+                out += "] ";
+                out += ansi::FIRE;
+                out += " Batch #";
+                append(r.id);
+                out += " (";
+                append(r.messages);
+                out += " messages, Parse: ";
+                out += ansi::WHITE;
+                append(r.time_us);
+                out += "μs";
+                out += ansi::BRIGHT_MAGENTA;
+                out += ", Compression: ";
+                out += ansi::WHITE;
+                append(r.compression_ratio);
+                out += '%';
+                out += ansi::BRIGHT_MAGENTA;
+                out += ')';
+                break;
+                
+            case log_event::critical_in_batch:
+                out += ansi::BRIGHT_RED;
+                out += "  → Critical message in batch: Seq #";
+                append(r.id);
+                out += ", Latency: ";
+                append(r.latency_ms);
+                out += "ms";
+                break;
+        }
+        out += ansi::RESET;
+        out += '\n';
+    }
+};
+
+// Aggregates for one window bucket. Latency is bucketed by half-octaves of
+// microseconds: coarse, but small enough to keep one per bucket.
+struct rollup_bucket {
+    static constexpr size_t latency_buckets = 48;
+    
+    uint64_t epoch = std::numeric_limits<uint64_t>::max();
+    uint64_t count = 0;
+    int64_t lost = 0;               // Net of gaps later filled
+    int64_t min_ns = 0;
+    int64_t max_ns = 0;
+    double sum_ns = 0.0;
+    std::array<uint32_t, latency_buckets> latency{};
+    
+    static size_t latency_bucket(int64_t latency_ns) {
+        uint64_t us = static_cast<uint64_t>(std::max<int64_t>(0, latency_ns)) / 1000;
+        if (us < 2) return us;
+        size_t octave = std::bit_width(us) - 1;
+        return std::min(latency_buckets - 1, 2 * octave + ((us >> (octave - 1)) & 1));
+    }
+    
+    static double latency_bucket_ms(size_t bucket) {
+        if (bucket < 2) return bucket / 1000.0;
+        uint64_t half = 1ULL << (bucket / 2 - 1);
+        return ((2 + bucket % 2) * half + half - 1) / 1000.0;
+    }
+    
+    void reset(uint64_t bucket_epoch) { *this = rollup_bucket{}; epoch = bucket_epoch; }
+};
+
+struct rollup_summary {
+    uint64_t count = 0;
+    uint64_t lost = 0;
+    double min_ms = 0.0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// Ring of `span` buckets, each `width_ns` long; a bucket is recycled as
+// soon as time moves into its next lap
+class rollup_window {
+public:
+    rollup_window(uint64_t width_ns, size_t span) : width_ns_(width_ns), buckets_(span) {}
+    
+    void add(uint64_t now_ns, int64_t latency_ns, int64_t lost) {
+        uint64_t epoch = now_ns / width_ns_;
+        rollup_bucket& bucket = buckets_[epoch % buckets_.size()];
+        if (bucket.epoch != epoch) bucket.reset(epoch);
+        
+        bucket.lost += lost;
+        if (bucket.count == 0 || latency_ns < bucket.min_ns) bucket.min_ns = latency_ns;
+        if (bucket.count == 0 || latency_ns > bucket.max_ns) bucket.max_ns = latency_ns;
+        bucket.count++;
+        bucket.sum_ns += latency_ns;
+        bucket.latency[rollup_bucket::latency_bucket(latency_ns)]++;
+    }
+    
+    rollup_summary summarize(uint64_t now_ns) const {
+        uint64_t epoch = now_ns / width_ns_;
+        rollup_summary summary;
+        std::array<uint64_t, rollup_bucket::latency_buckets> latency{};
+        int64_t min_ns = 0, max_ns = 0, lost = 0;
+        double sum_ns = 0.0;
+        
+        for (const auto& bucket : buckets_) {
+            if (bucket.epoch > epoch || epoch - bucket.epoch >= buckets_.size()) continue;
+            lost += bucket.lost;
+            if (bucket.count == 0) continue;
+            
+            if (summary.count == 0 || bucket.min_ns < min_ns) min_ns = bucket.min_ns;
+            if (summary.count == 0 || bucket.max_ns > max_ns) max_ns = bucket.max_ns;
+            summary.count += bucket.count;
+            sum_ns += bucket.sum_ns;
+            for (size_t i = 0; i < latency.size(); ++i) latency[i] += bucket.latency[i];
+        }
+        summary.lost = static_cast<uint64_t>(std::max<int64_t>(0, lost));
+        if (summary.count == 0) return summary;
+        
+        summary.min_ms = min_ns / 1e6;
+        summary.max_ms = max_ns / 1e6;
+        summary.mean_ms = sum_ns / summary.count / 1e6;
+        
+        auto percentile = [&](double fraction) {
+            uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * summary.count));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < latency.size(); ++i) {
+                seen += latency[i];
+                if (seen >= rank) return std::min(rollup_bucket::latency_bucket_ms(i), summary.max_ms);
+            }
+            return summary.max_ms;
+        };
+        summary.p50_ms = percentile(0.50);
+        summary.p99_ms = percentile(0.99);
+        return summary;
+    }
+    
+private:
+    uint64_t width_ns_;
+    std::vector<rollup_bucket> buckets_;
+};
+
+// Lifetime delivery figures for one source
+struct sequence_summary {
+    uint64_t received = 0;
+    uint64_t lost = 0;              // Gaps not (yet) filled by late arrivals
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;         // Arrived after a higher sequence number
+    uint64_t late = 0;              // Too far behind the window to classify
+    double jitter_ms = 0.0;
+};
+
+struct source_summary {
+    std::string source_id;
+    sequence_summary delivery;
+    rollup_summary second;
+    rollup_summary minute;
+    rollup_summary hour;
+};
+
+// Loss, duplicate and reorder detection over a bitmap of the last 256
+// sequence numbers (bit i is highest - i), plus the RFC 3550 interarrival
+// jitter estimate: J += (|D| - J) / 16, D being the change in transit time.
+// Clock offset between sender and listener cancels out of D.
+class sequence_tracker {
+public:
+    static constexpr uint32_t window_bits = 256;
+    
+    // Returns the change in outstanding loss: the gap this arrival opened,
+    // or -1 when it filled an earlier one
+    int64_t record(uint32_t sequence, uint64_t sender_ns, uint64_t arrival_ns) {
+        int64_t transit = static_cast<int64_t>(arrival_ns - sender_ns);
+        if (received_ > 0) {
+            double change = std::abs(static_cast<double>(transit - last_transit_));
+            jitter_ns_ += (change - jitter_ns_) / 16.0;
+        }
+        last_transit_ = transit;
+        
+        if (received_++ == 0) {
+            restart(sequence);
+            return 0;
+        }
+        
+        if (sequence > highest_) {
+            uint32_t ahead = sequence - highest_;
+            if (ahead >= restart_gap) {
+                restart(sequence);
+                return 0;
+            }
+            shift(ahead);
+            highest_ = sequence;
+            mark(0);
+            lost_ += ahead - 1;
+            return ahead - 1;
+        }
+        
+        uint32_t behind = highest_ - sequence;
+        if (behind >= restart_gap) {
+            restart(sequence);
+            return 0;
+        }
+        if (behind >= window_bits) {
+            late_++;
+            return 0;
+        }
+        if (seen(behind)) {
+            duplicates_++;
+            return 0;
+        }
+        
+        mark(behind);
+        reordered_++;
+        if (lost_ == 0) return 0;
+        lost_--;
+        return -1;
+    }
+    
+    sequence_summary summary() const {
+        return {received_, lost_, duplicates_, reordered_, late_, jitter_ns_ / 1e6};
+    }
+    
+private:
+    // A jump this large either way is a sender restart, not loss
+    static constexpr uint32_t restart_gap = 1u << 20;
+    
+    std::array<uint64_t, window_bits / 64> seen_{};
+    uint32_t highest_ = 0;
+    uint64_t received_ = 0;
+    uint64_t lost_ = 0;
+    uint64_t duplicates_ = 0;
+    uint64_t reordered_ = 0;
+    uint64_t late_ = 0;
+    int64_t last_transit_ = 0;
+    double jitter_ns_ = 0.0;
+    
+    bool seen(uint32_t behind) const { return (seen_[behind / 64] >> (behind % 64)) & 1; }
+    void mark(uint32_t behind) { seen_[behind / 64] |= 1ULL << (behind % 64); }
+    
+    void restart(uint32_t sequence) {
+        seen_.fill(0);
+        highest_ = sequence;
+        mark(0);
+    }
+    
+    // Ages the window by n sequence numbers
+    void shift(uint32_t n) {
+        if (n >= window_bits) {
+            seen_.fill(0);
+            return;
+        }
+        size_t words = n / 64, bits = n % 64;
+        for (size_t i = seen_.size(); i-- > 0;) {
+            uint64_t value = i >= words ? seen_[i - words] << bits : 0;
+            if (bits != 0 && i > words) value |= seen_[i - words - 1] >> (64 - bits);
+            seen_[i] = value;
+        }
+    }
+};
+
+// One source's last second (10 x 100ms), minute (12 x 5s) and hour
+// (60 x 1min). Callers serialise access.
+class source_rollup {
+public:
+    void record(int64_t latency_ns, int64_t lost, uint64_t now_ns) {
+        second_.add(now_ns, latency_ns, lost);
+        minute_.add(now_ns, latency_ns, lost);
+        hour_.add(now_ns, latency_ns, lost);
+    }
+    
+    void summarize(uint64_t now_ns, source_summary& into) const {
+        into.second = second_.summarize(now_ns);
+        into.minute = minute_.summarize(now_ns);
+        into.hour = hour_.summarize(now_ns);
+    }
+    
+private:
+    rollup_window second_{100000000ULL, 10};
+    rollup_window minute_{5000000000ULL, 12};
+    rollup_window hour_{60000000000ULL, 60};
+};
+
+// Per-source state shared by every parser thread, keyed by the interned
+// source_id. Open addressing with linear probing over a fixed array: a new
+// source claims a slot with one CAS on its key, and a claimed slot never
+// moves or goes away, so finding a source takes no lock. Each slot
+// serialises its own updates with a spinlock, which only contends when two
+// threads see the same source at once. Rollups cost ~20KB a source, so only
+// the first max_rollups sources get them; every source gets delivery
+// tracking. Names the interner had no room for (and empty ones) are not
+// sources: they would merge unrelated senders' sequence numbers.
+class source_table {
+public:
+    static constexpr uint32_t max_rollups = 4096;
+    
+    explicit source_table(size_t capacity) {
+        size_t size = 64;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        claim_limit_ = size - size / 8;     // Keep probe chains short
+        
+        slots_ = std::make_unique<slot[]>(size);
+        order_ = std::make_unique<std::atomic<uint32_t>[]>(size);
+        for (size_t i = 0; i < size; ++i) order_[i].store(unclaimed, std::memory_order_relaxed);
+    }
+    
+    void record(symbol source_id, uint32_t sequence, uint64_t sender_ns, uint64_t arrival_ns) {
+        bool named = source_id.id != string_interner::overflow_id && source_id.id != string_interner::empty_id;
+        slot* entry = named ? find_or_claim(source_id) : nullptr;
+        if (!entry) {
+            overflowed_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        while (entry->busy.test_and_set(std::memory_order_acquire)) cpu_relax();
+        int64_t lost = entry->tracker.record(sequence, sender_ns, arrival_ns);
+        if (entry->rollup) {
+            entry->rollup->record(static_cast<int64_t>(arrival_ns - sender_ns), lost, arrival_ns);
+        }
+        entry->busy.clear(std::memory_order_release);
+    }
+    
+    // Busiest sources first: by the last minute where rolled up, else lifetime
+    std::vector<source_summary> snapshot(uint64_t now_ns, size_t limit) const {
+        std::vector<source_summary> summaries;
+        uint32_t used = std::min<uint32_t>(used_.load(std::memory_order_acquire), mask_ + 1);
+        summaries.reserve(used);
+        
+        for (uint32_t i = 0; i < used; ++i) {
+            uint32_t index = order_[i].load(std::memory_order_acquire);
+            if (index == unclaimed) continue;
+            const slot& entry = slots_[index];
+            if (!entry.ready.load(std::memory_order_acquire)) continue;
+            
+            auto& summary = summaries.emplace_back();
+            summary.source_id = entry.source_id.view();
+            while (entry.busy.test_and_set(std::memory_order_acquire)) cpu_relax();
+            summary.delivery = entry.tracker.summary();
+            if (entry.rollup) entry.rollup->summarize(now_ns, summary);
+            entry.busy.clear(std::memory_order_release);
+        }
+        
+        auto activity = [](const source_summary& s) { return s.minute.count > 0 ? s.minute.count : s.delivery.received; };
+        size_t keep = std::min(limit, summaries.size());
+        std::partial_sort(summaries.begin(), summaries.begin() + keep, summaries.end(),
+                          [&](const source_summary& a, const source_summary& b) { return activity(a) > activity(b); });
+        summaries.resize(keep);
+        return summaries;
+    }
+    
+    uint32_t size() const { return used_.load(std::memory_order_relaxed); }
+    uint64_t overflowed() const { return overflowed_.load(std::memory_order_relaxed); }
+    
+private:
+    static constexpr uint32_t unclaimed = std::numeric_limits<uint32_t>::max();
+    
+    struct alignas(64) slot {
+        std::atomic<uint64_t> key{0};           // Symbol id + 1, 0 while empty
+        std::atomic<bool> ready{false};         // Name and rollup are in place
+        mutable std::atomic_flag busy;
+        symbol source_id;
+        sequence_tracker tracker;
+        std::unique_ptr<source_rollup> rollup;
+    };
+    
+    std::unique_ptr<slot[]> slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> order_;    // Claimed slots, oldest first
+    uint32_t mask_ = 0;
+    uint32_t claim_limit_ = 0;
+    std::atomic<uint32_t> used_{0};
+    std::atomic<uint32_t> rollups_{0};
+    std::atomic<uint64_t> overflowed_{0};
+    
+    // Ids are dense, so scatter them (Fibonacci hashing) to keep runs apart
+    slot* find_or_claim(symbol source_id) {
+        uint64_t key = uint64_t(source_id.id) + 1;     // Never 0
+        uint32_t start = static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+        
+        for (uint32_t probe = 0, i = start & mask_; probe <= mask_; ++probe, i = (i + 1) & mask_) {
+            slot& entry = slots_[i];
+            uint64_t current = entry.key.load(std::memory_order_acquire);
+            
+            if (current == 0) {
+                if (used_.load(std::memory_order_relaxed) >= claim_limit_) return nullptr;
+                if (entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                    entry.source_id = source_id;
+                    if (rollups_.load(std::memory_order_relaxed) < max_rollups &&
+                        rollups_.fetch_add(1, std::memory_order_relaxed) < max_rollups) {
+                        entry.rollup = std::make_unique<source_rollup>();
+                    }
+                    entry.ready.store(true, std::memory_order_release);
+                    order_[used_.fetch_add(1, std::memory_order_acq_rel)].store(i, std::memory_order_release);
+                    return &entry;
+                }
+                // Lost the race; `current` now holds the winner's key
+            }
+            
+            if (current == key) {
+                while (!entry.ready.load(std::memory_order_acquire)) cpu_relax();
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Windows WSA initialization
+class wsa_initializer {
+public:
+    wsa_initializer() {
+#ifdef _WIN32
+        WSADATA wsaData;
+        int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+        initialized_ = (result == 0);
+        if (!initialized_) {
+            std::cerr << ansi::BRIGHT_RED << "❌ WSAStartup failed: " << result << ansi::RESET << std::endl;
+        }
+#else
+        initialized_ = true;
+#endif
+    }
+    
+    ~wsa_initializer() {
+#ifdef _WIN32
+        if (initialized_) WSACleanup();
+#endif
+    }
+    
+    bool is_initialized() const { return initialized_; }
+    
+private:
+    bool initialized_;
+};
+
+inline uint32_t detect_simd_capability() {
+    #ifdef __AVX512F__
+        return 512;
+    #elif defined(__AVX2__)
+        return 256;
+    #elif defined(__AVX__)
+        return 128;
+    #elif defined(__ARM_NEON)
+        return 128;
+    #else
+        return 64;
+    #endif
+}
+
+inline int get_last_socket_error() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+inline std::string get_socket_error_string(int error_code) {
+#ifdef _WIN32
+    char* error_msg = nullptr;
+    FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM,
+                   nullptr, error_code, 0, (LPSTR)&error_msg, 0, nullptr);
+    std::string result = error_msg ? error_msg : "Unknown error";
+    if (error_msg) LocalFree(error_msg);
+    return result;
+#else
+    return std::string(strerror(error_code));
+#endif
+}
+
+// Bounded lock-free MPMC ring (Vyukov). Every cell carries a sequence number,
+// so producers and consumers each claim a slot with one CAS and hand the value
+// over in place - no per-item allocation. Cells and cursors are cache-line
+// padded to keep producers and consumers off each other's lines.
+template<typename T>
+class mpmc_ring {
+private:
+    struct alignas(64) cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+        
+        T* item() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+    
+    std::unique_ptr<cell[]> cells_;
+    size_t mask_;
+    overflow_policy policy_;
+    
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> closed_{false};
+    
+public:
+    explicit mpmc_ring(size_t capacity, overflow_policy policy = overflow_policy::block)
+        : policy_(policy) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        
+        cells_ = std::make_unique<cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    ~mpmc_ring() {
+        T discard;
+        while (try_pop(discard)) {}
+    }
+    
+    mpmc_ring(const mpmc_ring&) = delete;
+    mpmc_ring& operator=(const mpmc_ring&) = delete;
+    
+    // Moves from `item` only on success
+    bool try_push(T&& item) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell* target;
+        
+        while (true) {
+            target = &cells_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        new (target->storage) T(std::move(item));
+        target->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool try_pop(T& result) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell* target;
+        
+        while (true) {
+            target = &cells_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        T* item = target->item();
+        result = std::move(*item);
+        item->~T();
+        target->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Applies the overflow policy when full; false means the item was not queued
+    bool push(T&& item) {
+        if (try_push(std::move(item))) return true;
+        
+        switch (policy_) {
+            case overflow_policy::drop_newest:
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+                
+            case overflow_policy::drop_oldest: {
+                T victim;
+                while (!try_push(std::move(item))) {
+                    if (try_pop(victim)) dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                return true;
+            }
+                
+            case overflow_policy::block:
+            default:
+                for (uint32_t attempt = 1; !try_push(std::move(item)); ++attempt) {
+                    if (closed_.load(std::memory_order_relaxed)) {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    if (attempt < 64) {
+                        std::this_thread::yield();
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                }
+                return true;
+        }
+    }
+    
+    // Releases producers blocked on a full ring (used at shutdown)
+    void close() { closed_.store(true, std::memory_order_relaxed); }
+    
+    size_t size() const {
+        size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+    
+    size_t capacity() const { return mask_ + 1; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+// Stage-1 structural scanner (simdjson style): classifies quotes, backslashes
+// and braces 64 bytes at a time and reports where top-level frames end.
+// Escape/string/depth state carries across calls, so every byte of a
+// connection's stream is scanned exactly once no matter how it is segmented.
+class frame_scanner {
+public:
+    // Scans buffer[scanned, size) and appends the end offset (exclusive) of
+    // every top-level frame that closes in that range.
+    void scan(std::string_view buffer, std::vector<size_t>& frame_ends) {
+        const char* data = buffer.data();
+        size_t pos = scanned_;
+
+        while (buffer.size() - pos >= 64) {
+            scan_block(data + pos, pos, frame_ends);
+            pos += 64;
+        }
+
+        for (; pos < buffer.size(); ++pos) {
+            scan_byte(data[pos], pos, frame_ends);
+        }
+
+        scanned_ = pos;
+    }
+
+    // The caller dropped `count` already-framed bytes from the front of its buffer
+    void consume(size_t count) { scanned_ -= count; }
+
+    // A '}' closed more than was opened: no frame can ever end after it
+    bool unbalanced() const { return depth_ < 0; }
+
+    void reset() { *this = frame_scanner(); }
+
+private:
+    struct block_masks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t open;
+        uint64_t close;
+    };
+
+    size_t scanned_ = 0;
+    uint64_t prev_escaped_ = 0;    // 1 when the previous byte was an unescaped backslash
+    uint64_t prev_in_string_ = 0;  // all ones while inside a string
+    int64_t depth_ = 0;
+
+    static block_masks classify(const char* block) {
+        block_masks m;
+#if defined(__AVX2__)
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+        auto mask = [&](char c) {
+            const __m256i needle = _mm256_set1_epi8(c);
+            uint64_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+            uint64_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+            return l | (h << 32);
+        };
+#elif defined(__SSE2__)
+        __m128i chunks[4];
+        for (int i = 0; i < 4; ++i) {
+            chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+        }
+        auto mask = [&](char c) {
+            const __m128i needle = _mm_set1_epi8(c);
+            uint64_t result = 0;
+            for (int i = 0; i < 4; ++i) {
+                uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)));
+                result |= bits << (i * 16);
+            }
+            return result;
+        };
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        uint8x16_t chunks[4];
+        for (int i = 0; i < 4; ++i) {
+            chunks[i] = vld1q_u8(reinterpret_cast<const uint8_t*>(block + i * 16));
+        }
+        auto mask = [&](char c) {
+            static const uint8_t bit_values[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                                   0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+            const uint8x16_t bits = vld1q_u8(bit_values);
+            const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+            uint8x16_t m0 = vandq_u8(vceqq_u8(chunks[0], needle), bits);
+            uint8x16_t m1 = vandq_u8(vceqq_u8(chunks[1], needle), bits);
+            uint8x16_t m2 = vandq_u8(vceqq_u8(chunks[2], needle), bits);
+            uint8x16_t m3 = vandq_u8(vceqq_u8(chunks[3], needle), bits);
+            uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+            sum = vpaddq_u8(sum, sum);
+            return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+        };
+#else
+        auto mask = [&](char c) {
+            uint64_t result = 0;
+            for (int i = 0; i < 64; ++i) {
+                result |= static_cast<uint64_t>(block[i] == c) << i;
+            }
+            return result;
+        };
+#endif
+        m.quote = mask('"');
+        m.backslash = mask('\\');
+        m.open = mask('{');
+        m.close = mask('}');
+        return m;
+    }
+
+    static uint64_t prefix_xor(uint64_t bits) {
+#if defined(__PCLMUL__)
+        const __m128i all_ones = _mm_set1_epi8(static_cast<char>(0xFF));
+        const __m128i result = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(bits)), all_ones, 0);
+        return static_cast<uint64_t>(_mm_cvtsi128_si64(result));
+#else
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+#endif
+    }
+
+    // Marks every byte preceded by an odd run of backslashes
+    uint64_t find_escaped(uint64_t backslash) {
+        constexpr uint64_t even_bits = 0x5555555555555555ULL;
+
+        backslash &= ~prev_escaped_;
+        uint64_t follows_escape = (backslash << 1) | prev_escaped_;
+        uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+        uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+        prev_escaped_ = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+        uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+
+        return (even_bits ^ invert_mask) & follows_escape;
+    }
+
+    void scan_block(const char* block, size_t offset, std::vector<size_t>& frame_ends) {
+        block_masks m = classify(block);
+        uint64_t entry_escaped = prev_escaped_;
+        uint64_t entry_in_string = prev_in_string_;
+
+        uint64_t escaped = find_escaped(m.backslash);
+        uint64_t quote = m.quote & ~escaped;
+        uint64_t in_string = prefix_xor(quote) ^ prev_in_string_;
+        prev_in_string_ = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        // Only backslashes inside strings escape. The masks above hold up to
+        // the first one outside a string, so on such (malformed) input the
+        // block is redone a byte at a time from its entry state.
+        if (m.backslash & ~in_string) {
+            prev_escaped_ = entry_escaped;
+            prev_in_string_ = entry_in_string;
+            for (int i = 0; i < 64; ++i) scan_byte(block[i], offset + i, frame_ends);
+            return;
+        }
+
+        uint64_t structurals = (m.open | m.close) & ~in_string;
+        while (structurals && depth_ >= 0) {
+            int bit = std::countr_zero(structurals);
+            if ((m.open >> bit) & 1) {
+                depth_++;
+            } else if (--depth_ == 0) {
+                frame_ends.push_back(offset + bit + 1);
+            }
+            structurals &= structurals - 1;
+        }
+    }
+
+    // Byte-at-a-time equivalent of scan_block, used for the trailing partial block
+    void scan_byte(char c, size_t offset, std::vector<size_t>& frame_ends) {
+        bool escaped = prev_escaped_ != 0;
+        prev_escaped_ = 0;
+
+        if (!escaped) {
+            if (c == '\\' && prev_in_string_) {
+                prev_escaped_ = 1;
+                return;
+            }
+            if (c == '"') {
+                prev_in_string_ = ~prev_in_string_;
+                return;
+            }
+        }
+
+        if (prev_in_string_ || depth_ < 0) return;
+
+        if (c == '{') {
+            depth_++;
+        } else if (c == '}' && --depth_ == 0) {
+            frame_ends.push_back(offset + 1);
+        }
+    }
+};
+
+// Hierarchical timer wheel: 11 levels of 64 slots cover every 64-bit
+// microsecond tick.
+// A timer sits at the level of the highest 6-bit digit where its expiry
+// differs from the current tick, and cascades one level down each time the
+// wheel reaches its slot, so it always fires on its exact tick. Per-level
+// occupancy bitmaps let the wheel find the next event without walking slots.
+class timer_wheel {
+public:
+    static constexpr int levels = 11;
+    static constexpr int slot_bits = 6;
+    static constexpr uint64_t slot_count = 1ULL << slot_bits;
+    static constexpr uint64_t never = ~0ULL;
+    
+    explicit timer_wheel(uint64_t now = 0) : now_(now) {}
+    
+    uint64_t now() const { return now_; }
+    bool empty() const { return count_ == 0; }
+    
+    // Expiries already in the past fire on the next advance()
+    void insert(uint64_t id, uint64_t expiry) {
+        expiry = std::max(expiry, now_);
+        
+        uint64_t differing = expiry ^ now_;
+        int level = differing ? (63 - std::countl_zero(differing)) / slot_bits : 0;
+        uint64_t slot = digit(expiry, level);
+        
+        slots_[level][slot].push_back({id, expiry});
+        occupied_[level] |= 1ULL << slot;
+        count_++;
+    }
+    
+    // Earliest tick at which advance() has work to do: a level-0 slot firing
+    // or a higher slot cascading. never when the wheel is empty.
+    uint64_t next_event() const {
+        if (count_ == 0) return never;
+        
+        uint64_t best = never;
+        for (int level = 0; level < levels; ++level) {
+            uint64_t current = digit(now_, level);
+            uint64_t pending = occupied_[level] & (level == 0 ? (~0ULL << current)
+                                                              : (current == slot_count - 1 ? 0 : ~0ULL << (current + 1)));
+            if (!pending) continue;
+            
+            uint64_t slot = static_cast<uint64_t>(std::countr_zero(pending));
+            int shift = slot_bits * level;
+            uint64_t window = shift + slot_bits >= 64 ? 0 : (now_ >> (shift + slot_bits)) << (shift + slot_bits);
+            best = std::min(best, window | (slot << shift));
+        }
+        return best;
+    }
+    
+    // Moves time forward to target, calling fire(id) for every timer that
+    // expires on the way. fire may insert new timers.
+    template<typename Fn>
+    void advance(uint64_t target, Fn&& fire) {
+        while (true) {
+            uint64_t next = next_event();
+            if (next > target) {
+                now_ = std::max(now_, target);
+                return;
+            }
+            now_ = next;
+            
+            // Top-down so anything cascading into the current level-0 slot fires this round
+            for (int level = levels - 1; level > 0; --level) {
+                int shift = slot_bits * level;
+                if (now_ & ((1ULL << shift) - 1)) continue;
+                
+                uint64_t slot = digit(now_, level);
+                if (!(occupied_[level] & (1ULL << slot))) continue;
+                
+                scratch_.swap(slots_[level][slot]);
+                occupied_[level] &= ~(1ULL << slot);
+                count_ -= scratch_.size();
+                for (const auto& timer : scratch_) insert(timer.id, timer.expiry);
+                scratch_.clear();
+            }
+            
+            uint64_t slot = digit(now_, 0);
+            if (occupied_[0] & (1ULL << slot)) {
+                firing_.swap(slots_[0][slot]);
+                occupied_[0] &= ~(1ULL << slot);
+                count_ -= firing_.size();
+                for (const auto& timer : firing_) fire(timer.id);
+                firing_.clear();
+            }
+        }
+    }
+    
+private:
+    struct timer {
+        uint64_t id;
+        uint64_t expiry;
+    };
+    
+    std::vector<timer> slots_[levels][slot_count];
+    uint64_t occupied_[levels] = {};
+    std::vector<timer> scratch_;
+    std::vector<timer> firing_;
+    uint64_t now_;
+    size_t count_ = 0;
+    
+    static uint64_t digit(uint64_t tick, int level) {
+        return (tick >> (slot_bits * level)) & (slot_count - 1);
+    }
+};
+
+// Runs periodic and one-shot jobs off a timer_wheel on one thread. Between
+// deadlines the thread is blocked on a condition variable, so an idle
+// scheduler never wakes. Periodic jobs re-arm from their previous deadline,
+// not from when they ran, so they do not drift.
+class job_scheduler {
+public:
+    using job_id = uint64_t;
+    using clock = std::chrono::steady_clock;
+    
+    job_scheduler() : epoch_(clock::now()) {}
+    ~job_scheduler() { stop(); }
+    
+    job_scheduler(const job_scheduler&) = delete;
+    job_scheduler& operator=(const job_scheduler&) = delete;
+    
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) return;
+        running_ = true;
+        thread_ = std::thread([this]() { run(); });
+    }
+    
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+        }
+        wakeup_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+    
+    // First run after first_delay, then every interval
+    job_id every(std::chrono::microseconds interval, std::chrono::microseconds first_delay, std::function<void()> fn) {
+        return add(std::max<int64_t>(0, first_delay.count()), std::max<int64_t>(1, interval.count()), std::move(fn));
+    }
+    
+    job_id after(std::chrono::microseconds delay, std::function<void()> fn) {
+        return add(std::max<int64_t>(0, delay.count()), 0, std::move(fn));
+    }
+    
+    // A cancelled job is dropped when its timer next comes due
+    void cancel(job_id id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.erase(id);
+    }
+    
+    // Called on the scheduler thread after each round of due jobs
+    void set_round_hook(std::function<void()> hook) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        round_hook_ = std::move(hook);
+    }
+    
+private:
+    struct job {
+        std::function<void()> fn;
+        uint64_t interval_us;
+        uint64_t expiry;
+    };
+    
+    clock::time_point epoch_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    timer_wheel wheel_;
+    std::unordered_map<job_id, std::shared_ptr<job>> jobs_;
+    std::function<void()> round_hook_;
+    job_id next_id_ = 1;
+    bool running_ = false;
+    std::thread thread_;
+    
+    uint64_t now_us() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            clock::now() - epoch_).count());
+    }
+    
+    job_id add(int64_t delay_us, int64_t interval_us, std::function<void()> fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        job_id id = next_id_++;
+        auto entry = std::make_shared<job>();
+        entry->fn = std::move(fn);
+        entry->interval_us = static_cast<uint64_t>(interval_us);
+        entry->expiry = std::max(wheel_.now(), now_us()) + static_cast<uint64_t>(delay_us);
+        
+        bool earlier = entry->expiry < wheel_.next_event();
+        wheel_.insert(id, entry->expiry);
+        jobs_.emplace(id, std::move(entry));
+        
+        // Only disturb the scheduler when its current sleep is now too long
+        if (earlier) wakeup_.notify_one();
+        return id;
+    }
+    
+    void run() {
+        std::vector<std::shared_ptr<job>> due;
+        std::unique_lock<std::mutex> lock(mutex_);
+        
+        while (running_) {
+            uint64_t next = wheel_.next_event();
+            
+            if (next == timer_wheel::never) {
+                wakeup_.wait(lock);
+                continue;
+            }
+            
+            uint64_t now = now_us();
+            if (next > now) {
+                wakeup_.wait_until(lock, epoch_ + std::chrono::microseconds(next));
+                continue;
+            }
+            
+            wheel_.advance(now, [&](uint64_t id) {
+                auto it = jobs_.find(id);
+                if (it == jobs_.end()) return;
+                
+                due.push_back(it->second);
+                if (it->second->interval_us == 0) {
+                    jobs_.erase(it);
+                    return;
+                }
+                
+                // Skip missed periods rather than firing a burst to catch up
+                job& periodic = *it->second;
+                periodic.expiry += periodic.interval_us;
+                if (periodic.expiry <= now) {
+                    periodic.expiry += ((now - periodic.expiry) / periodic.interval_us + 1) * periodic.interval_us;
+                }
+                wheel_.insert(id, periodic.expiry);
+            });
+            
+            auto hook = round_hook_;
+            lock.unlock();
+            for (auto& entry : due) entry->fn();
+            due.clear();
+            if (hook) hook();
+            lock.lock();
+        }
+    }
+};
+
+// Transmit stage: payloads are copied once into an arena as they become
+// ready, and every destination's send points at those same bytes. On Linux
+// a flush is a single sendmmsg, and consecutive equal-sized payloads bound
+// for one destination go out as one UDP_SEGMENT (GSO) message.
+// Only one thread may use a stage at a time.
+class udp_tx_stage {
+public:
+    static constexpr size_t max_payloads = 64;
+    static constexpr size_t max_destinations = 64;
+    
+    // Kernel limits for one GSO send: 64 segments, one IP datagram of payload
+    static constexpr size_t gso_max_segments = 64;
+    static constexpr size_t gso_max_bytes = 65000;
+    
+    // Each segment must fit the path MTU on its own; assume Ethernet's 1500
+    static constexpr size_t path_mtu = 1500;
+    static constexpr size_t gso_max_segment_v4 = path_mtu - 20 - 8;
+    static constexpr size_t gso_max_segment_v6 = path_mtu - 40 - 8;
+    
+    struct destination_counters {
+        std::string name;
+        uint64_t sent;
+        uint64_t errors;
+    };
+    
+    void attach(int fd) {
+        fd_ = fd;
+        gso_.store(probe_gso(fd), std::memory_order_relaxed);
+    }
+    
+    // Destinations are registered before any sending thread starts
+    uint32_t add_destination(const std::string& name, const sockaddr* address, socklen_t length) {
+        auto& added = destinations_.emplace_back();
+        added.name = name;
+        std::memcpy(&added.address, address, length);
+        added.length = length;
+        return static_cast<uint32_t>(destinations_.size() - 1);
+    }
+    
+    size_t destination_count() const { return destinations_.size(); }
+    const std::string& destination_name(uint32_t destination) const { return destinations_[destination].name; }
+
+    // Destination a reply came from, or -1
+    int find_destination(const sockaddr_storage& address) const {
+        for (size_t d = 0; d < destinations_.size(); ++d) {
+            const sockaddr_storage& candidate = destinations_[d].address;
+            if (candidate.ss_family != address.ss_family) continue;
+
+            if (address.ss_family == AF_INET) {
+                auto a = reinterpret_cast<const sockaddr_in*>(&address);
+                auto b = reinterpret_cast<const sockaddr_in*>(&candidate);
+                if (a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr) return static_cast<int>(d);
+            } else if (address.ss_family == AF_INET6) {
+                auto a = reinterpret_cast<const sockaddr_in6*>(&address);
+                auto b = reinterpret_cast<const sockaddr_in6*>(&candidate);
+                if (a->sin6_port == b->sin6_port &&
+                    std::memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0) return static_cast<int>(d);
+            }
+        }
+        return -1;
+    }
+    
+    uint64_t all_destinations() const {
+        return destinations_.size() >= 64 ? ~0ULL : (1ULL << destinations_.size()) - 1;
+    }
+    
+    bool full() const { return payloads_.size() >= max_payloads; }
+    bool empty() const { return payloads_.empty(); }
+    
+    // Bit d of destination_mask sends the payload to destination d
+    size_t enqueue(std::string_view datagram, uint64_t destination_mask) {
+        payloads_.push_back({arena_.size(), datagram.size(), destination_mask});
+        arena_.append(datagram.data(), datagram.size());
+        return payloads_.size() - 1;
+    }
+    
+    // Sends everything queued; on_result(payload, destination, error) reports
+    // each datagram, error 0 meaning it was handed to the kernel
+    template<typename Fn>
+    size_t flush(Fn&& on_result) {
+        build_entries();
+        size_t sent = 0;
+        
+        auto report = [&](size_t i, int error) {
+            const entry& e = entries_[i];
+            auto& destination = destinations_[e.destination];
+            if (error == 0) {
+                destination.sent.fetch_add(1, std::memory_order_relaxed);
+                sent++;
+            } else {
+                destination.errors.fetch_add(1, std::memory_order_relaxed);
+                errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+            on_result(e.payload, e.destination, error);
+        };
+        
+#ifdef __linux__
+        size_t start = 0;
+        size_t plain_until = 0;
+        while (start < entries_.size()) {
+            build_messages(start, plain_until);
+            
+            size_t group = 0;
+            bool retry_without_gso = false;
+            
+            while (group < groups_.size()) {
+                int result = sendmmsg(fd_, &messages_[group], 
+                                      static_cast<unsigned int>(groups_.size() - group), MSG_DONTWAIT);
+                syscalls_.fetch_add(1, std::memory_order_relaxed);
+                
+                if (result > 0) {
+                    for (int m = 0; m < result; ++m) {
+                        const auto& g = groups_[group + m];
+                        for (size_t i = g.first; i < g.first + g.count; ++i) report(i, 0);
+                    }
+                    group += static_cast<size_t>(result);
+                    continue;
+                }
+                
+                int error = errno;
+                if (error == EINTR) continue;
+                
+                const auto& g = groups_[group];
+                if (g.count > 1 && (error == EIO || error == EINVAL || error == ENOPROTOOPT || error == EOPNOTSUPP)) {
+                    // No UDP_SEGMENT support at all means plain sends for good;
+                    // anything else only costs this group its segmentation
+                    if (error == ENOPROTOOPT || error == EOPNOTSUPP) gso_.store(false, std::memory_order_relaxed);
+                    start = g.first;
+                    plain_until = g.first + g.count;
+                    retry_without_gso = true;
+                    break;
+                }
+                
+                for (size_t i = g.first; i < g.first + g.count; ++i) report(i, error);
+                group++;
+            }
+            
+            if (!retry_without_gso) break;
+        }
+#else
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            const entry& e = entries_[i];
+            const payload& p = payloads_[e.payload];
+            const auto& destination = destinations_[e.destination];
+            
+            int result = sendto(fd_, arena_.data() + p.offset, static_cast<int>(p.length), MSG_DONTWAIT,
+                                reinterpret_cast<const sockaddr*>(&destination.address), destination.length);
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            
+            report(i, result >= 0 ? 0 : get_last_socket_error());
+        }
+#endif
+        
+        datagrams_.fetch_add(sent, std::memory_order_relaxed);
+        payloads_.clear();
+        entries_.clear();
+        arena_.clear();
+        return sent;
+    }
+    
+    uint64_t datagrams_sent() const { return datagrams_.load(std::memory_order_relaxed); }
+    uint64_t syscalls() const { return syscalls_.load(std::memory_order_relaxed); }
+    uint64_t send_errors() const { return errors_.load(std::memory_order_relaxed); }
+    bool gso_enabled() const { return gso_.load(std::memory_order_relaxed); }
+    
+    std::vector<destination_counters> destination_stats() const {
+        std::vector<destination_counters> result;
+        result.reserve(destinations_.size());
+        for (const auto& destination : destinations_) {
+            result.push_back({destination.name, 
+                              destination.sent.load(std::memory_order_relaxed),
+                              destination.errors.load(std::memory_order_relaxed)});
+        }
+        return result;
+    }
+    
+private:
+    struct payload {
+        size_t offset;
+        size_t length;
+        uint64_t destinations;
+    };
+    
+    // One datagram: a payload bound for one destination
+    struct entry {
+        uint32_t payload;
+        uint32_t destination;
+    };
+    
+    struct destination_address {
+        std::string name;
+        sockaddr_storage address{};
+        socklen_t length = 0;
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> errors{0};
+    };
+    
+    int fd_ = -1;
+    std::string arena_;
+    std::vector<payload> payloads_;
+    std::vector<entry> entries_;
+    std::deque<destination_address> destinations_;
+    
+    std::atomic<uint64_t> datagrams_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<bool> gso_{false};
+    
+    // Destination-major order, so each destination's payloads sit next to
+    // each other and can share one GSO message
+    void build_entries() {
+        entries_.clear();
+        for (uint32_t d = 0; d < destinations_.size(); ++d) {
+            for (uint32_t p = 0; p < payloads_.size(); ++p) {
+                if (payloads_[p].destinations & (1ULL << d)) entries_.push_back({p, d});
+            }
+        }
+    }
+    
+    static bool probe_gso(int fd) {
+#ifdef __linux__
+        if (fd < 0) return false;
+        int segment = 0;
+        socklen_t length = sizeof(segment);
+        return getsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, &length) == 0;
+#else
+        (void)fd;
+        return false;
+#endif
+    }
+    
+#ifdef __linux__
+    struct message_group {
+        size_t first;
+        size_t count;
+    };
+    
+    // Room for one UDP_SEGMENT control message per group
+    struct alignas(cmsghdr) control_buffer {
+        char bytes[CMSG_SPACE(sizeof(uint16_t))];
+    };
+    
+    std::vector<message_group> groups_;
+    std::vector<mmsghdr> messages_;
+    std::vector<iovec> iovecs_;
+    std::vector<control_buffer> controls_;
+    
+    size_t max_segment(uint32_t destination) const {
+        return destinations_[destination].address.ss_family == AF_INET6 ? gso_max_segment_v6 : gso_max_segment_v4;
+    }
+    
+    // Groups entries from start onward. A GSO group is a run of adjacent
+    // payloads to one destination where every segment has the first one's
+    // size, except that the last may be shorter - the shape UDP_SEGMENT
+    // splits back out. Segments must fit the MTU, so bigger payloads go alone;
+    // entries before plain_until are sent without GSO.
+    void build_messages(size_t start, size_t plain_until) {
+        groups_.clear();
+        bool gso = gso_.load(std::memory_order_relaxed);
+        
+        for (size_t i = start; i < entries_.size();) {
+            size_t count = 1;
+            size_t segment = payloads_[entries_[i].payload].length;
+            
+            if (gso && i >= plain_until && segment <= max_segment(entries_[i].destination)) {
+                size_t bytes = segment;
+                
+                while (i + count < entries_.size() && count < gso_max_segments) {
+                    const entry& previous = entries_[i + count - 1];
+                    const entry& next = entries_[i + count];
+                    size_t length = payloads_[next.payload].length;
+                    
+                    if (next.destination != previous.destination || next.payload != previous.payload + 1 ||
+                        length > segment || bytes + length > gso_max_bytes) {
+                        break;
+                    }
+                    
+                    bytes += length;
+                    count++;
+                    if (length < segment) break;
+                }
+            }
+            
+            groups_.push_back({i, count});
+            i += count;
+        }
+        
+        messages_.assign(groups_.size(), mmsghdr{});
+        iovecs_.resize(groups_.size());
+        controls_.resize(groups_.size());
+        
+        for (size_t g = 0; g < groups_.size(); ++g) {
+            const message_group& group = groups_[g];
+            const entry& first = entries_[group.first];
+            const payload& first_payload = payloads_[first.payload];
+            const payload& last_payload = payloads_[entries_[group.first + group.count - 1].payload];
+            
+            // Adjacent payloads were appended back to back, so a run is contiguous
+            iovecs_[g].iov_base = arena_.data() + first_payload.offset;
+            iovecs_[g].iov_len = last_payload.offset + last_payload.length - first_payload.offset;
+            
+            msghdr& header = messages_[g].msg_hdr;
+            header.msg_name = &destinations_[first.destination].address;
+            header.msg_namelen = destinations_[first.destination].length;
+            header.msg_iov = &iovecs_[g];
+            header.msg_iovlen = 1;
+            
+            if (group.count > 1) {
+                header.msg_control = controls_[g].bytes;
+                header.msg_controllen = sizeof(controls_[g].bytes);
+                
+                cmsghdr* control = CMSG_FIRSTHDR(&header);
+                control->cmsg_level = SOL_UDP;
+                control->cmsg_type = UDP_SEGMENT;
+                control->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment = static_cast<uint16_t>(first_payload.length);
+                std::memcpy(CMSG_DATA(control), &segment, sizeof(segment));
+            }
+        }
+    }
+#endif
+};
+
+// Splits "[name=]host:port" or "[name=][v6addr]:port" and resolves the host.
+// Anything after the first ',' is left for per-destination options.
+inline bool resolve_destination(const std::string& spec, std::string& name,
+                                sockaddr_storage& address, socklen_t& length) {
+    std::string endpoint = spec.substr(0, spec.find(','));
+    
+    size_t equals = endpoint.find('=');
+    if (equals != std::string::npos) {
+        name = endpoint.substr(0, equals);
+        endpoint = endpoint.substr(equals + 1);
+    } else {
+        name = endpoint;
+    }
+    
+    std::string host;
+    std::string port;
+    if (!endpoint.empty() && endpoint[0] == '[') {
+        size_t close_bracket = endpoint.find(']');
+        if (close_bracket == std::string::npos || close_bracket + 1 >= endpoint.size() || 
+            endpoint[close_bracket + 1] != ':') {
+            return false;
+        }
+        host = endpoint.substr(1, close_bracket - 1);
+        port = endpoint.substr(close_bracket + 2);
+    } else {
+        size_t colon = endpoint.rfind(':');
+        if (colon == std::string::npos) return false;
+        host = endpoint.substr(0, colon);
+        port = endpoint.substr(colon + 1);
+    }
+    
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0 || !results) {
+        return false;
+    }
+    
+    std::memcpy(&address, results->ai_addr, results->ai_addrlen);
+    length = static_cast<socklen_t>(results->ai_addrlen);
+    freeaddrinfo(results);
+    return true;
+}
+
+// Value of a ",key=value" option in a destination spec, or empty
+inline std::string destination_option(const std::string& spec, const std::string& key) {
+    size_t pos = spec.find(',');
+    while (pos != std::string::npos) {
+        size_t end = spec.find(',', pos + 1);
+        std::string option = spec.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        if (option.size() > key.size() && option.compare(0, key.size(), key) == 0 && option[key.size()] == '=') {
+            return option.substr(key.size() + 1);
+        }
+        pos = end;
+    }
+    return {};
+}
+
+// "250us", "5ms", "2s"; a bare number is milliseconds. 0 when unparsable.
+inline uint64_t parse_duration_us(const std::string& text) {
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc()) return 0;
+    
+    std::string_view unit(end, text.data() + text.size() - end);
+    if (unit == "us") return value;
+    if (unit == "s") return value * 1000000;
+    if (unit.empty() || unit == "ms") return value * 1000;
+    if (unit == "m") return value * 60000000;
+    if (unit == "h") return value * 3600000000ULL;
+    if (unit == "d") return value * 86400000000ULL;
+    return 0;
+}
+
+#ifdef __linux__
+// Control buffer for one SO_TIMESTAMPNS arrival stamp
+struct alignas(cmsghdr) receive_stamp_buffer {
+    char bytes[CMSG_SPACE(sizeof(timespec))];
+};
+
+// The kernel's arrival stamp for a received datagram, on the realtime clock
+// high_resolution_clock reads; fallback_ns if the socket did not ask for one
+inline uint64_t kernel_receive_ns(msghdr& header, uint64_t fallback_ns) {
+    for (cmsghdr* control = CMSG_FIRSTHDR(&header); control; control = CMSG_NXTHDR(&header, control)) {
+        if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec stamp;
+            std::memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+            return uint64_t(stamp.tv_sec) * 1000000000ULL + uint64_t(stamp.tv_nsec);
+        }
+    }
+    return fallback_ns;
+}
+#endif
+
+struct clock_summary {
+    std::string name;
+    uint64_t samples = 0;
+    double rtt_us = 0.0;            // Of the sample the offset comes from
+    double min_rtt_us = 0.0;        // Lifetime
+    double offset_us = 0.0;         // Peer clock minus ours
+    double drift_ppm = 0.0;
+    latency_summary one_way;        // Corrected, beacon sent to beacon received
+};
+
+// NTP-style clock estimate for one peer from echo round trips. For a beacon
+// stamped t1 here, received t2 and answered t3 there, and whose pong
+// arrived at t4 (RFC 5905 on-wire math):
+//     rtt = (t4 - t1) - (t3 - t2)     offset = ((t2 - t1) + (t3 - t4)) / 2
+// The offset can be wrong by up to rtt/2 and queueing only ever adds delay,
+// so the offset in use is that of the lowest-RTT sample among the last
+// filter_size. The lowest-RTT sample of each second is kept as well, and
+// the least-squares slope through those is the drift. Written by one
+// thread; the published figures are relaxed atomics like latency_histogram.
+class clock_estimator {
+public:
+    static constexpr size_t filter_size = 8;
+    static constexpr size_t history_size = 64;          // Seconds of drift baseline
+    static constexpr uint64_t history_period_ns = 1000000000;
+
+    void add(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+        // Unsigned differences wrap into the right signed values
+        int64_t rtt = static_cast<int64_t>(t4 - t1) - static_cast<int64_t>(t3 - t2);
+        if (rtt < 0 || t3 < t2) return;     // Stamps from a stale or restarted peer
+        int64_t offset = (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2;
+
+        filter_[samples_ % filter_size] = {t4, rtt, offset};
+        samples_++;
+        const sample& best = *std::min_element(filter_, filter_ + std::min<uint64_t>(samples_, filter_size),
+                                               [](const sample& a, const sample& b) { return a.rtt < b.rtt; });
+
+        if (period_best_.rtt < 0 || rtt < period_best_.rtt) period_best_ = {t4, rtt, offset};
+        if (t4 - period_start_ >= history_period_ns) {
+            if (period_start_ != 0) add_history_point(period_best_);
+            period_start_ = t4;
+            period_best_ = {t4, rtt, offset};
+        }
+
+        // Extrapolated to when the beacon was sent, in the peer's terms
+        double offset_then = best.offset + drift_ * static_cast<double>(static_cast<int64_t>(t1 - best.local_ns));
+        double one_way = static_cast<double>(static_cast<int64_t>(t2 - t1)) - offset_then;
+        one_way_.record(static_cast<uint64_t>(std::max(0.0, one_way)));
+
+        published_samples_.store(samples_, std::memory_order_relaxed);
+        published_rtt_.store(best.rtt, std::memory_order_relaxed);
+        published_offset_.store(best.offset, std::memory_order_relaxed);
+        if (min_rtt_.load(std::memory_order_relaxed) < 0 || rtt < min_rtt_.load(std::memory_order_relaxed)) {
+            min_rtt_.store(rtt, std::memory_order_relaxed);
+        }
+    }
+
+    void summarize(clock_summary& into) const {
+        into.samples = published_samples_.load(std::memory_order_relaxed);
+        into.rtt_us = published_rtt_.load(std::memory_order_relaxed) / 1000.0;
+        into.min_rtt_us = std::max<int64_t>(0, min_rtt_.load(std::memory_order_relaxed)) / 1000.0;
+        into.offset_us = published_offset_.load(std::memory_order_relaxed) / 1000.0;
+        into.drift_ppm = published_drift_ppm_.load(std::memory_order_relaxed);
+        std::vector<uint64_t> counts;
+        one_way_.add_to(counts);
+        into.one_way = latency_summary::from_counts(counts);
+    }
+
+private:
+    struct sample {
+        uint64_t local_ns = 0;      // t4
+        int64_t rtt = -1;
+        int64_t offset = 0;
+    };
+
+    sample filter_[filter_size];
+    sample history_[history_size];
+    uint64_t samples_ = 0;
+    uint64_t history_count_ = 0;
+    uint64_t period_start_ = 0;
+    sample period_best_;
+    double drift_ = 0.0;            // Offset change per local nanosecond
+
+    latency_histogram one_way_;
+    std::atomic<uint64_t> published_samples_{0};
+    std::atomic<int64_t> published_rtt_{0};
+    std::atomic<int64_t> published_offset_{0};
+    std::atomic<int64_t> min_rtt_{-1};
+    std::atomic<double> published_drift_ppm_{0.0};
+
+    // Once a second, so a full least-squares refit is cheap
+    void add_history_point(const sample& point) {
+        history_[history_count_ % history_size] = point;
+        history_count_++;
+        size_t count = std::min<uint64_t>(history_count_, history_size);
+        if (count < 3) return;
+
+        // Relative to the first point, so doubles keep nanosecond precision
+        const sample& origin = history_[history_count_ > history_size ? history_count_ % history_size : 0];
+        double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+        for (size_t i = 0; i < count; ++i) {
+            double x = static_cast<double>(static_cast<int64_t>(history_[i].local_ns - origin.local_ns));
+            double y = static_cast<double>(history_[i].offset - origin.offset);
+            sum_x += x; sum_y += y; sum_xx += x * x; sum_xy += x * y;
+        }
+        double denominator = count * sum_xx - sum_x * sum_x;
+        if (denominator <= 0) return;
+
+        drift_ = (count * sum_xy - sum_x * sum_y) / denominator;
+        published_drift_ppm_.store(drift_ * 1e6, std::memory_order_relaxed);
+    }
+};
+
+// Enhanced beacon transmitter with beautiful output! 🌈
+class lighthouse_beacon_v3 {
+private:
+    int socket_fd_;
+    std::atomic<uint32_t> sequence_counter_{0};
+    std::atomic<uint32_t> batch_counter_{0};
+    std::atomic<bool> is_active_{false};
+    
+    monitor_config config_;
+    performance_counters perf_counters_;
+    
+    // Paces every stream and batch linger deadline; all sending happens on its thread
+    job_scheduler scheduler_;
+    udp_tx_stage tx_;
+    
+    // Destinations that share an interval and encoding share a stream, so each of its
+    // beacons is built and serialized once for all of them. Every stream numbers its
+    // own beacons, so each sends under its own source id: two streams reaching one
+    // listener must not interleave their sequence spaces in its loss tracking.
+    struct beacon_stream {
+        symbol source_id;
+        uint64_t interval_us = 0;
+        wire_format wire = wire_format::json;
+        uint64_t destinations = 0;
+        uint32_t next_sequence = 0;
+        batch_message batch{};
+        job_scheduler::job_id linger_job = 0;
+        wire_encoder::beacon_template beacon_bytes;
+    };
+    std::vector<std::unique_ptr<beacon_stream>> streams_;
+    
+    // What a datagram's log line needs once its send result is known
+    struct tx_note {
+        bool is_batch;
+        uint32_t id;
+        size_t messages;
+        size_t bytes;
+        long long serialize_us;
+        uint64_t compression_ratio;
+        uint32_t targets;
+        uint32_t delivered;
+    };
+    std::vector<tx_note> notes_;
+    std::string compressed_output_;
+    
+    // Echo mode: one estimate per peer address, fed by the pongs coming back.
+    // Destinations that share an address (say, one per encoding) share a peer.
+    struct peer_clock {
+        std::string name;
+        clock_estimator estimator;
+    };
+    std::vector<std::unique_ptr<peer_clock>> peers_;
+    std::vector<uint32_t> peer_of_;     // By destination
+    
+public:
+    explicit lighthouse_beacon_v3(const monitor_config& config) 
+        : config_(config), socket_fd_(-1) {
+        initialize_socket();
+    }
+    
+    ~lighthouse_beacon_v3() {
+        stop();
+        if (socket_fd_ >= 0) close(socket_fd_);
+    }
+    
+    bool initialize_socket() {
+        std::vector<std::string> specs = config_.destinations;
+        if (specs.empty()) {
+            bool v6_literal = config_.target_host.find(':') != std::string::npos;
+            specs.push_back((v6_literal ? "[" + config_.target_host + "]" : config_.target_host) + 
+                            ":" + std::to_string(config_.target_port));
+        }
+        
+        struct resolved_destination {
+            std::string name;
+            sockaddr_storage address;
+            socklen_t length;
+            uint64_t interval_us;
+            wire_format wire;
+        };
+        std::vector<resolved_destination> resolved;
+        bool any_v6 = false;
+        
+        for (const auto& spec : specs) {
+            resolved_destination d{};
+            if (!resolve_destination(spec, d.name, d.address, d.length)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Invalid destination: " << spec << ansi::RESET << std::endl;
+                continue;
+            }
+            if (resolved.size() >= udp_tx_stage::max_destinations) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Too many destinations, ignoring: " << spec << ansi::RESET << std::endl;
+                continue;
+            }
+            
+            d.interval_us = uint64_t(config_.beacon_interval_ms) * 1000;
+            std::string every = destination_option(spec, "every");
+            if (!every.empty()) {
+                d.interval_us = parse_duration_us(every);
+                if (d.interval_us == 0) {
+                    std::cerr << ansi::BRIGHT_RED << "❌ Invalid interval in destination: " << spec << ansi::RESET << std::endl;
+                    continue;
+                }
+            }
+            
+            d.wire = config_.beacon_wire;
+            std::string wire = destination_option(spec, "wire");
+            if (!wire.empty() && !parse_wire_format(wire, d.wire)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Invalid wire format in destination: " << spec << ansi::RESET << std::endl;
+                continue;
+            }
+            
+            any_v6 |= (d.address.ss_family == AF_INET6);
+            resolved.push_back(d);
+        }
+        
+        // One socket serves every peer; IPv6 peers need a dual-stack one
+        socket_fd_ = socket(any_v6 ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+        if (socket_fd_ < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ Socket creation failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            return false;
+        }
+        
+        int opt = 1;
+        setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        
+        if (any_v6) {
+            int v6_only = 0;
+            setsockopt(socket_fd_, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&v6_only, sizeof(v6_only));
+        }
+        
+        int sndbuf = 1048576;
+        setsockopt(socket_fd_, SOL_SOCKET, SO_SNDBUF, (char*)&sndbuf, sizeof(sndbuf));
+        
+        if (config_.echo_replies) {
+            // Pongs wait here until the next scheduler round drains them
+            int rcvbuf = 1048576;
+            setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, (char*)&rcvbuf, sizeof(rcvbuf));
+#ifdef __linux__
+            setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+#endif
+        }
+        
+        tx_.attach(socket_fd_);
+        
+        for (auto& d : resolved) {
+            if (any_v6 && d.address.ss_family == AF_INET) {
+                // IPv4 peers are reached through their v4-mapped address
+                sockaddr_in v4;
+                std::memcpy(&v4, &d.address, sizeof(v4));
+                
+                sockaddr_in6 mapped{};
+                mapped.sin6_family = AF_INET6;
+                mapped.sin6_port = v4.sin_port;
+                mapped.sin6_addr.s6_addr[10] = 0xff;
+                mapped.sin6_addr.s6_addr[11] = 0xff;
+                std::memcpy(&mapped.sin6_addr.s6_addr[12], &v4.sin_addr, 4);
+                
+                std::memcpy(&d.address, &mapped, sizeof(mapped));
+                d.length = sizeof(mapped);
+            }
+            int same_peer = tx_.find_destination(d.address);
+            uint32_t index = tx_.add_destination(d.name, reinterpret_cast<const sockaddr*>(&d.address), d.length);
+            if (config_.echo_replies) {
+                if (same_peer < 0) {
+                    peers_.push_back(std::make_unique<peer_clock>());
+                    peers_.back()->name = d.name;
+                }
+                peer_of_.push_back(same_peer < 0 ? static_cast<uint32_t>(peers_.size() - 1) : peer_of_[same_peer]);
+            }
+            
+            auto stream = std::find_if(streams_.begin(), streams_.end(), [&](const auto& existing) {
+                return existing->interval_us == d.interval_us && existing->wire == d.wire;
+            });
+            if (stream == streams_.end()) {
+                streams_.push_back(std::make_unique<beacon_stream>());
+                streams_.back()->source_id = streams_.size() == 1 ? std::string("whispr-lighthouse-v3")
+                    : "whispr-lighthouse-v3/" + std::to_string(streams_.size() - 1);
+                streams_.back()->interval_us = d.interval_us;
+                streams_.back()->wire = d.wire;
+                streams_.back()->batch.messages.reserve(config_.batch_size);
+                stream = streams_.end() - 1;
+            }
+            (*stream)->destinations |= 1ULL << index;
+        }
+        
+        return tx_.destination_count() > 0;
+    }
+    
+    void start() {
+        if (is_active_.exchange(true)) return;
+        
+        scheduler_.set_round_hook([this]() {
+            flush_tx();
+            if (config_.echo_replies) drain_pongs();
+        });
+        for (auto& stream : streams_) {
+            beacon_stream* raw = stream.get();
+            scheduler_.every(std::chrono::microseconds(raw->interval_us), std::chrono::microseconds(0), [this, raw]() {
+                emit_beacon(*raw);
+            });
+        }
+        scheduler_.start();
+               
+  	    std::cout << ansi::BRIGHT_GREEN << ansi::LIGHTHOUSE << " Lighthouse beacon V3 activated - SIMD: " 
+                  << detect_simd_capability() << "-bit, Batch size: " << config_.batch_size 
+                  << ", Linger: " << config_.batch_linger_us << "μs"
+                  << ", Compression: " << (config_.enable_compression && config_.batch_size > 1 ? "ON" : "OFF")
+                  << ", Templates: " << (config_.beacon_templates && config_.batch_size <= 1 ? "ON" : "OFF")
+                  << ", Destinations: " << tx_.destination_count()
+                  << ", Streams: " << streams_.size()
+                  << ", UDP GSO: " << (tx_.gso_enabled() ? "ON" : "OFF")
+                  << ", Echo: " << (config_.echo_replies ? "ON" : "OFF")
+                  << ansi::RESET << std::endl;
+    }
+    
+    void stop() {
+        if (!is_active_.exchange(false)) return;
+        
+        scheduler_.stop();
+        
+        // The scheduler thread is gone; send whatever was still lingering
+        for (auto& stream : streams_) {
+            if (!stream->batch.messages.empty()) stage_batch(*stream);
+        }
+        flush_tx();
+        async_logger::instance().flush();
+        
+        std::cout << ansi::BRIGHT_CYAN << "\n" << ansi::SPARKLE << " Performance Summary:" << ansi::RESET << "\n";
+        std::cout << ansi::YELLOW << "  SIMD String Ops: " << ansi::WHITE << perf_counters_.simd_string_ops.load() << "\n";
+        std::cout << ansi::YELLOW << "  SIMD Number Ops: " << ansi::WHITE << perf_counters_.simd_number_ops.load() << "\n";
+        std::cout << ansi::YELLOW << "  Allocations Saved: " << ansi::WHITE << perf_counters_.allocations_saved.load() << "\n";
+        std::cout << ansi::YELLOW << "  Branch Predictions Saved: " << ansi::WHITE << perf_counters_.branch_predictions_saved.load() << ansi::RESET << "\n";
+    }
+    
+    uint32_t get_sequence_counter() const { return sequence_counter_.load(); }
+    
+    network_stats get_tx_stats() const {
+        network_stats tx{};
+        tx.packets_sent = tx_.datagrams_sent();
+        tx.tx_syscalls = tx_.syscalls();
+        tx.tx_errors = tx_.send_errors();
+        tx.tx_gso = tx_.gso_enabled();
+        return tx;
+    }
+    
+    std::vector<udp_tx_stage::destination_counters> get_destination_stats() const {
+        return tx_.destination_stats();
+    }
+    
+    std::vector<clock_summary> get_clock_summaries() const {
+        std::vector<clock_summary> summaries;
+        for (const auto& peer : peers_) {
+            auto& summary = summaries.emplace_back();
+            summary.name = peer->name;
+            peer->estimator.summarize(summary);
+        }
+        return summaries;
+    }
+    
+private:
+    void emit_beacon(beacon_stream& stream) {
+        if (config_.beacon_templates && config_.batch_size <= 1 && stream.wire == wire_format::json) {
+            emit_templated_beacon(stream);
+            return;
+        }
+        
+        beacon_message msg{};
+        
+        msg.source_id = stream.source_id;
+        msg.message_type = "heartbeat";
+        msg.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        
+        // Sequence numbers are per stream (and so per source id): every receiver sees an unbroken run
+        msg.sequence_number = stream.next_sequence++;
+        
+        std::ostringstream payload_builder;
+        payload_builder << "Lighthouse V3 - SIMD:" << detect_simd_capability() 
+                       << " Seq:" << msg.sequence_number;
+        
+        msg.payload = payload_builder.str();
+        msg.is_critical = (msg.sequence_number % 100 == 0);
+        msg.simd_capability = detect_simd_capability();
+        msg.parse_time_us = 0.0;
+        msg.message_size = 0;
+        
+        sequence_counter_.fetch_add(1);
+        perf_counters_.allocations_saved.fetch_add(3);
+        
+        if (config_.batch_size <= 1) {
+            stage_beacon(stream, msg);
+            return;
+        }
+        
+        stream.batch.messages.push_back(std::move(msg));
+        
+        if (stream.batch.messages.size() >= config_.batch_size) {
+            // Full before the deadline: send now and drop the pending linger
+            if (stream.linger_job) {
+                scheduler_.cancel(stream.linger_job);
+                stream.linger_job = 0;
+            }
+            stage_batch(stream);
+        } else if (stream.batch.messages.size() == 1) {
+            beacon_stream* raw = &stream;
+            stream.linger_job = scheduler_.after(std::chrono::microseconds(config_.batch_linger_us), [this, raw]() {
+                raw->linger_job = 0;
+                if (!raw->batch.messages.empty()) stage_batch(*raw);
+            });
+        }
+    }
+    
+    // Template path: the bytes were rendered once, so a beacon is a few digit stores
+    void emit_templated_beacon(beacon_stream& stream) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        if (!stream.beacon_bytes.ready()) {
+            beacon_message prototype{};
+            prototype.source_id = stream.source_id;
+            prototype.message_type = "heartbeat";
+            prototype.simd_capability = detect_simd_capability();
+            stream.beacon_bytes.render(prototype, 
+                "Lighthouse V3 - SIMD:" + std::to_string(detect_simd_capability()) + " Seq:");
+        }
+        
+        uint32_t sequence = stream.next_sequence++;
+        uint64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            start_time.time_since_epoch()).count();
+        std::string_view datagram = stream.beacon_bytes.patch(timestamp_ns, sequence, sequence % 100 == 0);
+        
+        auto serialize_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start_time).count();
+        
+        sequence_counter_.fetch_add(1);
+        
+        if (tx_.full()) flush_tx();
+        tx_.enqueue(datagram, stream.destinations);
+        notes_.push_back({false, sequence, 1, datagram.size(), 
+                          static_cast<long long>(serialize_us), 0, 
+                          static_cast<uint32_t>(std::popcount(stream.destinations)), 0});
+    }
+    
+    void stage_beacon(beacon_stream& stream, beacon_message& msg) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        std::string& output = wire_encoder::thread_buffer();
+        if (stream.wire == wire_format::binary) {
+            binary_wire::serialize(msg, output);
+        } else {
+            wire_encoder::serialize(msg, output);
+        }
+        msg.message_size = output.size();
+        
+        auto serialize_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start_time).count();
+        
+        // Serialized once; every destination of the stream is sent the same bytes
+        if (tx_.full()) flush_tx();
+        tx_.enqueue(output, stream.destinations);
+        notes_.push_back({false, msg.sequence_number, 1, output.size(), 
+                          static_cast<long long>(serialize_us), 0, 
+                          static_cast<uint32_t>(std::popcount(stream.destinations)), 0});
+    }
+    
+    void stage_batch(beacon_stream& stream) {
+        batch_message& batch = stream.batch;
+        batch.batch_id = batch_counter_.fetch_add(1);
+        batch.compression_ratio = 100;
+        
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        std::string& output = wire_encoder::thread_buffer();
+        if (stream.wire == wire_format::binary) {
+            binary_wire::serialize(batch, output);
+        } else {
+            wire_encoder::serialize(batch, output);
+        }
+        
+        // Send the envelope only when it actually saves bytes; the ratio is
+        // what went on the wire against the encoding it replaces
+        std::string_view datagram = output;
+        compressed_output_.clear();
+        if (config_.enable_compression && frame_codec::compress(output, compressed_output_)) {
+            datagram = compressed_output_;
+        }
+        uint64_t compression_ratio = output.size() * 100 / datagram.size();
+        
+        auto serialize_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start_time).count();
+        
+        if (tx_.full()) flush_tx();
+        tx_.enqueue(datagram, stream.destinations);
+        notes_.push_back({true, batch.batch_id, batch.messages.size(), datagram.size(), 
+                          static_cast<long long>(serialize_us), compression_ratio,
+                          static_cast<uint32_t>(std::popcount(stream.destinations)), 0});
+        
+        // Keeps capacity, so the next batch reuses the vector
+        batch.messages.clear();
+    }
+    
+    // Runs once per scheduler round: everything staged goes out together
+    void flush_tx() {
+        if (tx_.empty()) return;
+        
+        tx_.flush([&](size_t index, uint32_t destination, int error) {
+            if (error == 0) {
+                notes_[index].delivered++;
+            } else {
+                std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                         << (notes_[index].is_batch ? "❌ Batch send failed" : "❌ Send failed") 
+                         << (tx_.destination_count() > 1 ? " to " + tx_.destination_name(destination) : "") 
+                         << ": " << get_socket_error_string(error) << ansi::RESET << std::endl;
+            }
+        });
+        
+        async_logger& logger = async_logger::instance();
+        for (const auto& note : notes_) {
+            if (note.delivered == 0) continue;
+            
+            if (log_record* record = logger.begin(note.is_batch ? log_event::batch_sent : log_event::beacon_sent, 
+                                                  log_level::info)) {
+                record->id = note.id;
+                record->messages = note.messages;
+                record->bytes = note.bytes;
+                record->time_us = static_cast<double>(note.serialize_us);
+                record->compression_ratio = note.compression_ratio;
+                record->fanout = tx_.destination_count() > 1;
+                record->delivered = note.delivered;
+                record->targets = note.targets;
+                logger.commit();
+            }
+            
+            if (note.is_batch) {
+                perf_counters_.simd_string_ops.fetch_add(note.messages);
+                perf_counters_.allocations_saved.fetch_add(note.messages * 2);
+            } else {
+                perf_counters_.simd_string_ops.fetch_add(1);
+            }
+        }
+        
+        notes_.clear();
+    }
+    
+#ifdef __linux__
+    // Takes everything that arrived since the last round in recvmmsg batches.
+    // The kernel stamps each pong on arrival, so draining late adds no RTT.
+    void drain_pongs() {
+        constexpr size_t batch_slots = 32;
+        
+        char payloads[batch_slots][64];
+        iovec slots[batch_slots];
+        sockaddr_storage senders[batch_slots];
+        receive_stamp_buffer stamps[batch_slots];
+        mmsghdr headers[batch_slots];
+        
+        while (true) {
+            for (size_t i = 0; i < batch_slots; ++i) {
+                slots[i] = {payloads[i], sizeof(payloads[i])};
+                headers[i] = mmsghdr{};
+                headers[i].msg_hdr.msg_iov = &slots[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+                headers[i].msg_hdr.msg_name = &senders[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+                headers[i].msg_hdr.msg_control = stamps[i].bytes;
+                headers[i].msg_hdr.msg_controllen = sizeof(stamps[i].bytes);
+            }
+            
+            int received = recvmmsg(socket_fd_, headers, batch_slots, MSG_DONTWAIT, nullptr);
+            if (received <= 0) return;
+            
+            uint64_t drained_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+            for (int i = 0; i < received; ++i) {
+                on_pong(std::string_view(payloads[i], headers[i].msg_len), senders[i], 
+                        kernel_receive_ns(headers[i].msg_hdr, drained_ns));
+            }
+            
+            if (static_cast<size_t>(received) < batch_slots) return;
+        }
+    }
+#else
+    // No kernel arrival stamps here, so a pong's RTT includes its wait for
+    // the round; the min-RTT filter keeps the ones drained promptly
+    void drain_pongs() {
+        char payload[64];
+        while (true) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(socket_fd_, &readable);
+            timeval timeout{0, 0};
+            if (select(static_cast<int>(socket_fd_) + 1, &readable, nullptr, nullptr, &timeout) <= 0) return;
+            
+            sockaddr_storage sender{};
+            socklen_t sender_len = sizeof(sender);
+            int length = recvfrom(socket_fd_, payload, sizeof(payload), 0, 
+                                  reinterpret_cast<sockaddr*>(&sender), &sender_len);
+            if (length <= 0) return;
+            
+            uint64_t arrival_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+            on_pong(std::string_view(payload, static_cast<size_t>(length)), sender, arrival_ns);
+        }
+    }
+#endif
+    
+    void on_pong(std::string_view datagram, const sockaddr_storage& sender, uint64_t arrival_ns) {
+        echo_wire::pong reply;
+        if (!echo_wire::decode(datagram, reply)) return;
+        int destination = tx_.find_destination(sender);
+        if (destination < 0) return;
+        peers_[peer_of_[destination]]->estimator.add(reply.origin_ns, reply.receive_ns, reply.transmit_ns, arrival_ns);
+    }
+};
+
+// Just enough of RFC 6455 to push text frames to browsers: the upgrade
+// handshake (SHA-1 + base64 of the client's key), unmasked server frames and
+// masked client frames, of which only close and ping are acted on.
+namespace websocket {
+
+enum opcode : uint8_t { text_frame = 0x1, close_frame = 0x8, ping_frame = 0x9, pong_frame = 0xA };
+
+inline constexpr std::string_view handshake_guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+inline constexpr size_t max_request_size = 8192;
+inline constexpr size_t max_client_payload = 65536;
+
+inline std::array<uint8_t, 20> sha1(std::string_view data) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    
+    std::string message(data);
+    uint64_t bit_length = static_cast<uint64_t>(data.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56) message.push_back('\0');
+    for (int shift = 56; shift >= 0; shift -= 8) message.push_back(static_cast<char>(bit_length >> shift));
+    
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(message.data() + chunk);
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[i * 4]) << 24) | (uint32_t(p[i * 4 + 1]) << 16) |
+                   (uint32_t(p[i * 4 + 2]) << 8) | uint32_t(p[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; ++i) w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            
+            uint32_t temp = std::rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    
+    std::array<uint8_t, 20> digest{};
+    for (int i = 0; i < 20; ++i) digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+    return digest;
+}
+
+inline std::string base64(const uint8_t* data, size_t length) {
+    static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    
+    std::string out;
+    out.reserve((length + 2) / 3 * 4);
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = uint32_t(data[i]) << 16;
+        if (i + 1 < length) group |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < length) group |= data[i + 2];
+        
+        out.push_back(alphabet[(group >> 18) & 63]);
+        out.push_back(alphabet[(group >> 12) & 63]);
+        out.push_back(i + 1 < length ? alphabet[(group >> 6) & 63] : '=');
+        out.push_back(i + 2 < length ? alphabet[group & 63] : '=');
+    }
+    return out;
+}
+
+inline std::string accept_key(std::string_view client_key) {
+    std::string material(client_key);
+    material += handshake_guid;
+    auto digest = sha1(material);
+    return base64(digest.data(), digest.size());
+}
+
+inline bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+inline bool contains_ignore_case(std::string_view haystack, std::string_view needle) {
+    for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        if (equals_ignore_case(haystack.substr(i, needle.size()), needle)) return true;
+    }
+    return false;
+}
+
+// Value of the first matching header in a raw HTTP request, trimmed
+inline std::string_view header_value(std::string_view request, std::string_view name) {
+    size_t line = request.find("\r\n");
+    while (line != std::string_view::npos) {
+        line += 2;
+        size_t end = request.find("\r\n", line);
+        if (end == std::string_view::npos || end == line) break;
+        
+        std::string_view header = request.substr(line, end - line);
+        size_t colon = header.find(':');
+        if (colon != std::string_view::npos && equals_ignore_case(header.substr(0, colon), name)) {
+            std::string_view value = header.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        line = end;
+    }
+    return {};
+}
+
+// Server frames are never masked and never fragmented
+inline std::string encode_frame(opcode code, std::string_view payload) {
+    std::string out;
+    out.reserve(payload.size() + 10);
+    out.push_back(static_cast<char>(0x80 | code));
+    
+    if (payload.size() < 126) {
+        out.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        out.push_back(static_cast<char>(126));
+        out.push_back(static_cast<char>(payload.size() >> 8));
+        out.push_back(static_cast<char>(payload.size()));
+    } else {
+        out.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<char>(uint64_t(payload.size()) >> shift));
+    }
+    
+    out.append(payload);
+    return out;
+}
+
+// Takes one client frame off the front of `input`, unmasked into `payload`.
+// Returns the bytes consumed, 0 if the frame is incomplete, SIZE_MAX if the
+// client broke the protocol (unmasked, oversized) and must be dropped.
+inline size_t decode_client_frame(std::string_view input, opcode& code, std::string& payload) {
+    if (input.size() < 2) return 0;
+    
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(input.data());
+    if ((p[1] & 0x80) == 0) return SIZE_MAX;
+    
+    size_t header = 2;
+    uint64_t length = p[1] & 0x7F;
+    if (length == 126) {
+        if (input.size() < 4) return 0;
+        length = (uint64_t(p[2]) << 8) | p[3];
+        header = 4;
+    } else if (length == 127) {
+        if (input.size() < 10) return 0;
+        length = 0;
+        for (int i = 0; i < 8; ++i) length = (length << 8) | p[2 + i];
+        header = 10;
+    }
+    if (length > max_client_payload) return SIZE_MAX;
+    if (input.size() < header + 4 + length) return 0;
+    
+    const uint8_t* mask = p + header;
+    const uint8_t* body = mask + 4;
+    payload.resize(length);
+    for (size_t i = 0; i < length; ++i) payload[i] = static_cast<char>(body[i] ^ mask[i & 3]);
+    
+    code = static_cast<opcode>(p[0] & 0x0F);
+    return header + 4 + length;
+}
+
+} // namespace websocket
+
+// Live feed for browsers. Every published event is framed once into a shared
+// buffer, and each viewer's queue holds references to those buffers, so the
+// cost per viewer is a pointer and its share of a writev. A viewer that
+// cannot keep up loses its oldest unsent frames - a live view wants the
+// newest state, not a backlog. One thread serves every viewer.
+class websocket_broadcaster {
+public:
+    struct counters {
+        uint32_t viewers;
+        uint64_t published;
+        uint64_t dropped;       // Frames a slow viewer never got
+        uint64_t rejected;      // Connections that failed the handshake
+    };
+    
+    websocket_broadcaster(uint16_t port, size_t client_queue_limit)
+        : port_(port), queue_limit_(std::max<size_t>(1, client_queue_limit)),
+          inbox_(4096, overflow_policy::drop_oldest) {}
+    
+    ~websocket_broadcaster() { stop(); }
+    
+    bool start() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) return false;
+        
+        int opt = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port_);
+        
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listen_fd_, 1024) < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ WebSocket listen on port " << port_ << " failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        
+#ifdef __linux__
+        fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL, 0) | O_NONBLOCK);
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = listen_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+        ev.data.fd = wake_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+#endif
+        
+        running_.store(true);
+        thread_ = std::thread([this]() { run(); });
+        return true;
+    }
+    
+    void stop() {
+        if (!running_.exchange(false)) return;
+        
+        wake();
+        if (thread_.joinable()) thread_.join();
+        
+        while (!clients_.empty()) drop_client(clients_.begin()->first);
+        close(listen_fd_);
+        listen_fd_ = -1;
+#ifdef __linux__
+        close(epoll_fd_);
+        close(wake_fd_);
+        epoll_fd_ = wake_fd_ = -1;
+#endif
+    }
+    
+    // Lets producers skip building a payload nobody will see
+    bool has_viewers() const { return viewers_.load(std::memory_order_relaxed) > 0; }
+    
+    // Safe from any thread; the frame is built here, once, for every viewer
+    void publish(std::string_view text) {
+        auto frame = std::make_shared<const std::string>(websocket::encode_frame(websocket::text_frame, text));
+        inbox_.push(std::move(frame));
+        published_.fetch_add(1, std::memory_order_relaxed);
+        
+        // One wakeup covers everything published until the loop drains
+        if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) wake();
+    }
+    
+    counters get_counters() const {
+        return {viewers_.load(std::memory_order_relaxed), published_.load(std::memory_order_relaxed),
+                dropped_.load(std::memory_order_relaxed), rejected_.load(std::memory_order_relaxed)};
+    }
+    
+private:
+    using frame_ptr = std::shared_ptr<const std::string>;
+    
+    struct client {
+        int fd = -1;
+        bool upgraded = false;
+        bool closing = false;           // Drop once the queue has drained
+        bool want_write = false;        // Kernel buffer was full; waiting for room
+        std::string input;
+        std::string payload;
+        std::deque<frame_ptr> queue;
+        size_t offset = 0;              // Bytes of queue.front() already sent
+    };
+    
+    static constexpr size_t max_iov = 64;
+    
+    uint16_t port_;
+    size_t queue_limit_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    
+    mpmc_ring<frame_ptr> inbox_;
+    std::atomic<bool> wake_pending_{false};
+#ifdef __linux__
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+#endif
+    
+    // Loop thread only
+    std::unordered_map<int, std::unique_ptr<client>> clients_;
+    
+    std::atomic<uint32_t> viewers_{0};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> rejected_{0};
+    
+    void wake() {
+#ifdef __linux__
+        if (wake_fd_ >= 0) {
+            uint64_t one = 1;
+            [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
+        }
+#endif
+    }
+    
+#ifdef __linux__
+    void run() {
+        std::array<epoll_event, 256> events;
+        
+        while (running_.load(std::memory_order_relaxed)) {
+            int ready = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+            if (ready < 0 && errno != EINTR) break;
+            
+            for (int e = 0; e < ready; ++e) {
+                int fd = events[e].data.fd;
+                
+                if (fd == wake_fd_) {
+                    uint64_t count;
+                    [[maybe_unused]] auto drained = read(wake_fd_, &count, sizeof(count));
+                    wake_pending_.store(false, std::memory_order_release);
+                } else if (fd == listen_fd_) {
+                    accept_clients();
+                } else if (auto it = clients_.find(fd); it != clients_.end()) {
+                    client& c = *it->second;
+                    bool alive = (events[e].events & (EPOLLHUP | EPOLLERR)) == 0;
+                    if (alive && (events[e].events & (EPOLLIN | EPOLLRDHUP))) alive = read_client(c);
+                    if (alive && (events[e].events & EPOLLOUT)) alive = flush_client(c);
+                    if (!alive) drop_client(fd);
+                }
+            }
+            
+            deliver_published();
+        }
+    }
+#else
+    // select() fallback: bounded by FD_SETSIZE and woken by a short timeout
+    // instead of an eventfd
+    void run() {
+        while (running_.load(std::memory_order_relaxed)) {
+            fd_set readable, writable;
+            FD_ZERO(&readable);
+            FD_ZERO(&writable);
+            FD_SET(listen_fd_, &readable);
+            int highest = listen_fd_;
+            
+            for (auto& [fd, c] : clients_) {
+                FD_SET(fd, &readable);
+                if (c->want_write) FD_SET(fd, &writable);
+                highest = std::max(highest, fd);
+            }
+            
+            timeval timeout{0, 20000};
+            int ready = select(highest + 1, &readable, &writable, nullptr, &timeout);
+            wake_pending_.store(false, std::memory_order_release);
+            
+            if (ready > 0) {
+                if (FD_ISSET(listen_fd_, &readable)) accept_clients();
+                
+                std::vector<int> dead;
+                for (auto& [fd, c] : clients_) {
+                    bool alive = true;
+                    if (FD_ISSET(fd, &readable)) alive = read_client(*c);
+                    if (alive && FD_ISSET(fd, &writable)) alive = flush_client(*c);
+                    if (!alive) dead.push_back(fd);
+                }
+                for (int fd : dead) drop_client(fd);
+            }
+            
+            deliver_published();
+        }
+    }
+#endif
+    
+    void accept_clients() {
+        for (int accepted = 0; accepted < 64; ++accepted) {
+#ifdef __linux__
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+            int fd = accept(listen_fd_, nullptr, nullptr);
+#endif
+            if (fd < 0) break;
+            
+#ifdef __linux__
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                close(fd);
+                continue;
+            }
+#else
+            if (fd >= FD_SETSIZE) {
+                close(fd);
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+#ifdef SO_NOSIGPIPE
+            int opt = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
+#endif
+#endif
+            auto c = std::make_unique<client>();
+            c->fd = fd;
+            clients_.emplace(fd, std::move(c));
+#ifndef __linux__
+            break;  // A blocking accept must not be retried without select
+#endif
+        }
+    }
+    
+    void drop_client(int fd) {
+        auto it = clients_.find(fd);
+        if (it == clients_.end()) return;
+        
+        if (it->second->upgraded) viewers_.fetch_sub(1, std::memory_order_relaxed);
+        close(fd);  // Also removes it from the epoll set
+        clients_.erase(it);
+    }
+    
+    // False means the client is gone
+    bool read_client(client& c) {
+        char buffer[4096];
+        auto received = recv(c.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received == 0) return false;
+        if (received < 0) {
+            int error = get_last_socket_error();
+#ifdef _WIN32
+            return error == WSAEWOULDBLOCK;
+#else
+            return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+#endif
+        }
+        
+        if (c.closing) return true;
+        c.input.append(buffer, static_cast<size_t>(received));
+        
+        if (!c.upgraded) {
+            size_t end = c.input.find("\r\n\r\n");
+            if (end == std::string::npos) return c.input.size() <= websocket::max_request_size;
+            if (!handshake(c, std::string_view(c.input).substr(0, end + 4))) return flush_client(c);
+            c.input.erase(0, end + 4);
+        }
+        
+        while (!c.closing) {
+            websocket::opcode code;
+            size_t used = websocket::decode_client_frame(c.input, code, c.payload);
+            if (used == 0) break;
+            if (used == SIZE_MAX) return false;
+            c.input.erase(0, used);
+            
+            if (code == websocket::close_frame) {
+                // Echo the status code back and hang up once it is sent
+                enqueue(c, std::make_shared<const std::string>(
+                    websocket::encode_frame(websocket::close_frame, std::string_view(c.payload).substr(0, 2))));
+                c.closing = true;
+            } else if (code == websocket::ping_frame) {
+                enqueue(c, std::make_shared<const std::string>(websocket::encode_frame(websocket::pong_frame, c.payload)));
+            }
+        }
+        
+        return flush_client(c);
+    }
+    
+    bool handshake(client& c, std::string_view request) {
+        std::string_view key = websocket::header_value(request, "Sec-WebSocket-Key");
+        
+        if (!request.starts_with("GET ") || key.empty() ||
+            !websocket::contains_ignore_case(websocket::header_value(request, "Upgrade"), "websocket")) {
+            enqueue(c, std::make_shared<const std::string>(
+                "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\n"
+                "Content-Length: 0\r\nConnection: close\r\n\r\n"));
+            c.closing = true;
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                               "Connection: Upgrade\r\nSec-WebSocket-Accept: ";
+        response += websocket::accept_key(key);
+        response += "\r\n\r\n";
+        enqueue(c, std::make_shared<const std::string>(std::move(response)));
+        
+        c.upgraded = true;
+        viewers_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    void enqueue(client& c, frame_ptr frame) {
+        if (c.queue.size() >= queue_limit_) {
+            // Keep a partly written frame: cutting it would corrupt the stream
+            auto victim = c.offset > 0 ? c.queue.begin() + 1 : c.queue.begin();
+            if (victim != c.queue.end()) {
+                c.queue.erase(victim);
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        c.queue.push_back(std::move(frame));
+    }
+    
+    void deliver_published() {
+        bool any = false;
+        frame_ptr frame;
+        while (inbox_.try_pop(frame)) {
+            for (auto& [fd, c] : clients_) {
+                if (c->upgraded && !c->closing) enqueue(*c, frame);
+            }
+            any = true;
+        }
+        if (!any) return;
+        
+        std::vector<int> dead;
+        for (auto& [fd, c] : clients_) {
+            if (!c->want_write && !c->queue.empty() && !flush_client(*c)) dead.push_back(fd);
+        }
+        for (int fd : dead) drop_client(fd);
+    }
+    
+    // Writes as much of the queue as the socket takes; false means drop it
+    bool flush_client(client& c) {
+        while (!c.queue.empty()) {
+#ifdef __linux__
+            iovec iov[max_iov];
+            size_t count = 0;
+            for (auto it = c.queue.begin(); it != c.queue.end() && count < max_iov; ++it, ++count) {
+                size_t skip = count == 0 ? c.offset : 0;
+                iov[count].iov_base = const_cast<char*>((*it)->data() + skip);
+                iov[count].iov_len = (*it)->size() - skip;
+            }
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            ssize_t sent = sendmsg(c.fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+            const std::string& front = *c.queue.front();
+            auto sent = send(c.fd, front.data() + c.offset, static_cast<int>(front.size() - c.offset), MSG_DONTWAIT);
+#endif
+            if (sent < 0) {
+                int error = get_last_socket_error();
+#ifdef _WIN32
+                if (error != WSAEWOULDBLOCK) return false;
+#else
+                if (error == EINTR) continue;
+                if (error != EAGAIN && error != EWOULDBLOCK) return false;
+#endif
+                watch_writable(c, true);
+                return true;
+            }
+            
+            size_t remaining = static_cast<size_t>(sent);
+            while (remaining > 0) {
+                size_t left = c.queue.front()->size() - c.offset;
+                if (remaining < left) {
+                    c.offset += remaining;
+                    break;
+                }
+                remaining -= left;
+                c.offset = 0;
+                c.queue.pop_front();
+            }
+        }
+        
+        watch_writable(c, false);
+        return !c.closing;
+    }
+    
+    void watch_writable(client& c, bool enable) {
+        if (c.want_write == enable) return;
+        c.want_write = enable;
+#ifdef __linux__
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (enable ? uint32_t(EPOLLOUT) : 0u);
+        ev.data.fd = c.fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
 #endif
     }
+};
+
+// Beacon history on disk: segmented, append-only files of fixed 128-byte
+// records, memory-mapped for both writing and querying. Every segment keeps
+// a sparse index of receive times (one entry per index_stride records), so a
+// time range is found with a binary search over the index plus a short scan.
+// Receive times are kept non-decreasing within a segment for that reason.
+struct history_record {
+    uint64_t received_ns;           // Listener clock
+    uint64_t timestamp_ns;          // Sender clock
+    uint64_t sequence_number;
+    double parse_time_us;
+    uint32_t message_size;
+    uint32_t flags;
+    char source_id[48];
+    char message_type[24];
+    char peer[16];
     
-    ~wsa_initializer() {
-#ifdef _WIN32
-        if (initialized_) WSACleanup();
+    static constexpr uint32_t critical = 1;
+};
+
+static_assert(sizeof(history_record) == 128, "history_record layout is part of the segment format");
+
+// Segment file: [segment_header][sparse index][records], sized for its full
+// capacity up front. `count` is the commit point - everything below it is
+// complete, so queries can run against a segment while it is being written.
+struct segment_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint32_t index_stride;
+    uint32_t reserved;
+    uint64_t records_offset;
+    uint64_t created_ns;
+    std::atomic<uint64_t> count;
+};
+
+class history_segment {
+public:
+    static constexpr uint64_t magic = 0x5447534948534C57ULL;   // "WLSHISGT"
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t index_stride = 256;
+    
+    history_segment() = default;
+    history_segment(const history_segment&) = delete;
+    history_segment& operator=(const history_segment&) = delete;
+    ~history_segment() { unmap(); }
+    
+    bool create(const std::string& path, uint64_t capacity, uint64_t created_ns) {
+#ifndef _WIN32
+        uint64_t index_entries = capacity / index_stride + 1;
+        uint64_t records_offset = (sizeof(segment_header) + index_entries * sizeof(uint64_t) + 4095) & ~uint64_t(4095);
+        
+        int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        
+        // Sparse file: disk is only used as records are written
+        length_ = records_offset + capacity * sizeof(history_record);
+        bool ok = ftruncate(fd, static_cast<off_t>(length_)) == 0 && map(fd, true);
+        ::close(fd);
+        if (!ok) return false;
+        
+        header_->version = version;
+        header_->record_size = sizeof(history_record);
+        header_->capacity = capacity;
+        header_->index_stride = index_stride;
+        header_->records_offset = records_offset;
+        header_->created_ns = created_ns;
+        header_->count.store(0, std::memory_order_relaxed);
+        header_->magic = magic;
+        attach();
+        return true;
+#else
+        (void)path; (void)capacity; (void)created_ns;
+        return false;
 #endif
     }
     
-    bool is_initialized() const { return initialized_; }
+    bool open_readonly(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        
+        struct stat info{};
+        bool ok = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(segment_header);
+        if (ok) {
+            length_ = static_cast<size_t>(info.st_size);
+            ok = map(fd, false);
+        }
+        ::close(fd);
+        if (!ok) return false;
+        
+        bool valid = header_->magic == magic && header_->version == version &&
+                     header_->record_size == sizeof(history_record) &&
+                     header_->index_stride == index_stride &&
+                     header_->records_offset + header_->capacity * sizeof(history_record) <= length_;
+        if (!valid) {
+            unmap();
+            return false;
+        }
+        attach();
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+    
+    // Writer thread only; the caller keeps received_ns non-decreasing
+    bool append(const history_record& record) {
+        if (written_ >= header_->capacity) return false;
+        
+        records_[written_] = record;
+        if (written_ % index_stride == 0) index_[written_ / index_stride] = record.received_ns;
+        written_++;
+        return true;
+    }
+    
+    // Makes everything appended so far visible to readers; returns how many
+    // records that added
+    uint64_t commit() {
+        uint64_t committed = header_->count.exchange(written_, std::memory_order_release);
+        return written_ - committed;
+    }
+    
+    uint64_t size() const { return header_->count.load(std::memory_order_acquire); }
+    bool full() const { return written_ >= header_->capacity; }
+    uint64_t created_ns() const { return header_->created_ns; }
+    const history_record& operator[](uint64_t i) const { return records_[i]; }
+    
+    // First record at or after `ns`: binary search over the index, then at
+    // most one stride of records
+    uint64_t lower_bound(uint64_t ns, uint64_t count) const {
+        uint64_t entries = (count + index_stride - 1) / index_stride;
+        uint64_t entry = std::partition_point(index_, index_ + entries,
+                                              [ns](uint64_t indexed) { return indexed < ns; }) - index_;
+        uint64_t i = entry == 0 ? 0 : (entry - 1) * index_stride;
+        while (i < count && records_[i].received_ns < ns) ++i;
+        return i;
+    }
+    
+    void unmap() {
+#ifndef _WIN32
+        if (header_) munmap(header_, length_);
+#endif
+        header_ = nullptr;
+    }
     
 private:
-    bool initialized_;
+    segment_header* header_ = nullptr;
+    uint64_t* index_ = nullptr;
+    history_record* records_ = nullptr;
+    size_t length_ = 0;
+    uint64_t written_ = 0;
+    
+#ifndef _WIN32
+    bool map(int fd, bool writable) {
+        void* memory = mmap(nullptr, length_, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) return false;
+        header_ = static_cast<segment_header*>(memory);
+        return true;
+    }
+#endif
+    
+    void attach() {
+        char* base = reinterpret_cast<char*>(header_);
+        index_ = reinterpret_cast<uint64_t*>(base + sizeof(segment_header));
+        records_ = reinterpret_cast<history_record*>(base + header_->records_offset);
+    }
 };
 
-inline uint32_t detect_simd_capability() {
-    #ifdef __AVX512F__
-        return 512;
-    #elif defined(__AVX2__)
-        return 256;
-    #elif defined(__AVX__)
-        return 128;
-    #elif defined(__ARM_NEON)
-        return 128;
-    #else
-        return 64;
-    #endif
+// Segment files are named by creation time, so name order is time order
+inline std::string segment_file_name(uint64_t created_ns) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "beacons-%020llu.seg", static_cast<unsigned long long>(created_ns));
+    return name;
 }
 
-inline int get_last_socket_error() {
-#ifdef _WIN32
-    return WSAGetLastError();
-#else
-    return errno;
-#endif
+inline std::vector<std::filesystem::path> list_segments(const std::string& directory) {
+    std::vector<std::filesystem::path> segments;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.starts_with("beacons-") && name.ends_with(".seg")) segments.push_back(entry.path());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
 }
 
-inline std::string get_socket_error_string(int error_code) {
-#ifdef _WIN32
-    char* error_msg = nullptr;
-    FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM,
-                   nullptr, error_code, 0, (LPSTR)&error_msg, 0, nullptr);
-    std::string result = error_msg ? error_msg : "Unknown error";
-    if (error_msg) LocalFree(error_msg);
-    return result;
-#else
-    return std::string(strerror(error_code));
-#endif
+inline uint64_t segment_created_ns(const std::filesystem::path& path) {
+    std::string name = path.filename().string();
+    uint64_t created = 0;
+    std::from_chars(name.data() + 8, name.data() + name.size(), created);
+    return created;
 }
 
-// Lock-free queue (same as before)
-template<typename T>
-class lock_free_queue {
+// Calls visit(record) for every stored record received in [from_ns, to_ns),
+// oldest first; returns the number of segments it had to open
+template<typename Fn>
+size_t scan_history(const std::string& directory, uint64_t from_ns, uint64_t to_ns, Fn&& visit) {
+    auto segments = list_segments(directory);
+    size_t opened = 0;
+    
+    for (size_t s = 0; s < segments.size(); ++s) {
+        // A segment ends where the next one begins
+        if (segment_created_ns(segments[s]) >= to_ns) break;
+        if (s + 1 < segments.size() && segment_created_ns(segments[s + 1]) < from_ns) continue;
+        
+        history_segment segment;
+        if (!segment.open_readonly(segments[s].string())) continue;
+        opened++;
+        
+        uint64_t count = segment.size();
+        for (uint64_t i = segment.lower_bound(from_ns, count); i < count; ++i) {
+            const history_record& record = segment[i];
+            if (record.received_ns >= to_ns) break;
+            visit(record);
+        }
+    }
+    return opened;
+}
+
+// Owns the directory while the listener runs. Parser threads hand records
+// over through a lock-free queue and never wait: if the writer falls behind,
+// new records are counted as dropped. The writer appends whatever has
+// queued up in one go and rolls to a new segment by size or age, deleting
+// segments that have aged out of retention.
+class history_store {
+public:
+    struct counters {
+        uint64_t stored;
+        uint64_t dropped;
+        uint32_t segments;
+    };
+    
+    explicit history_store(const monitor_config& config)
+        : directory_(config.history_dir),
+          segment_capacity_(std::max<uint64_t>(history_segment::index_stride,
+              uint64_t(config.history_segment_mb) * 1048576 / sizeof(history_record))),
+          segment_age_ns_(config.history_segment_age_us * 1000),
+          retention_ns_(config.history_retention_us * 1000),
+          queue_(65536, overflow_policy::drop_newest) {}
+    
+    ~history_store() { stop(); }
+    
+    bool start() {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (!roll(now_ns())) return false;
+        
+        running_.store(true);
+        writer_ = std::thread([this]() { writer_loop(); });
+        return true;
+    }
+    
+    void stop() {
+        if (!running_.exchange(false)) return;
+        queue_.close();
+        ready_.notify_all();
+        if (writer_.joinable()) writer_.join();
+        segment_.reset();
+    }
+    
+    // Any parser thread
+    void append(const beacon_message& msg, const std::string& client_ip, uint64_t received_ns, double parse_us) {
+        history_record record{};
+        record.received_ns = received_ns;
+        record.timestamp_ns = msg.timestamp_ns;
+        record.sequence_number = msg.sequence_number;
+        record.parse_time_us = parse_us;
+        record.message_size = msg.message_size;
+        record.flags = msg.is_critical ? history_record::critical : 0;
+        shm::copy_field(record.source_id, msg.source_id.view());
+        shm::copy_field(record.message_type, msg.message_type.view());
+        shm::copy_field(record.peer, client_ip);
+        
+        if (queue_.push(std::move(record))) ready_.notify_one();
+    }
+    
+    counters get_counters() const {
+        return {stored_.load(std::memory_order_relaxed), queue_.dropped(),
+                segments_.load(std::memory_order_relaxed)};
+    }
+    
+private:
+    std::string directory_;
+    uint64_t segment_capacity_;
+    uint64_t segment_age_ns_;
+    uint64_t retention_ns_;
+    
+    mpmc_ring<history_record> queue_;
+    event_count ready_;
+    std::atomic<bool> running_{false};
+    std::thread writer_;
+    
+    // Writer thread only
+    std::unique_ptr<history_segment> segment_;
+    uint64_t last_received_ns_ = 0;
+    
+    std::atomic<uint64_t> stored_{0};
+    std::atomic<uint32_t> segments_{0};
+    
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    
+    bool roll(uint64_t now) {
+        auto next = std::make_unique<history_segment>();
+        std::string path = (std::filesystem::path(directory_) / segment_file_name(now)).string();
+        if (!next->create(path, segment_capacity_, now)) {
+            std::cerr << ansi::BRIGHT_RED << "❌ History segment " << path << " failed: " 
+                      << get_socket_error_string(errno) << ansi::RESET << std::endl;
+            return false;
+        }
+        segment_ = std::move(next);
+        last_received_ns_ = now;
+        expire(now);
+        return true;
+    }
+    
+    void expire(uint64_t now) {
+        auto segments = list_segments(directory_);
+        uint32_t kept = static_cast<uint32_t>(segments.size());
+        
+        // Only whole segments go: one is past retention once its successor began before the cutoff
+        for (size_t s = 0; s + 1 < segments.size() && retention_ns_ > 0; ++s) {
+            if (segment_created_ns(segments[s + 1]) + retention_ns_ > now) break;
+            std::error_code error;
+            if (std::filesystem::remove(segments[s], error)) kept--;
+        }
+        segments_.store(kept, std::memory_order_relaxed);
+    }
+    
+    void commit() {
+        stored_.fetch_add(segment_->commit(), std::memory_order_relaxed);
+    }
+    
+    void writer_loop() {
+        history_record record;
+        
+        while (true) {
+            uint64_t appended = 0;
+            while (queue_.try_pop(record)) {
+                // Receive times from different parser threads can interleave slightly
+                record.received_ns = std::max(record.received_ns, last_received_ns_);
+                
+                bool aged = segment_age_ns_ > 0 && record.received_ns >= segment_->created_ns() + segment_age_ns_;
+                if (segment_->full() || aged) {
+                    commit();
+                    if (!roll(std::max(record.received_ns, now_ns()))) return;
+                    record.received_ns = last_received_ns_;
+                }
+                
+                segment_->append(record);
+                last_received_ns_ = record.received_ns;
+                
+                // Commit in slices so queries see a busy stream promptly
+                if (++appended % 4096 == 0) commit();
+            }
+            
+            if (appended > 0) commit();
+            
+            uint32_t key = ready_.prepare_wait();
+            if (queue_.size() > 0) {
+                ready_.cancel_wait();
+            } else if (!running_.load()) {
+                ready_.cancel_wait();
+                return;
+            } else {
+                ready_.wait(key);
+            }
+        }
+    }
+};
+
+// Enhanced multi-threaded listener with beautiful output! 
+class network_listener_v3 {
 private:
-    struct node {
-        std::atomic<T*> data;
-        std::atomic<node*> next;
-        node() : data(nullptr), next(nullptr) {}
+    int server_fd_;
+    std::atomic<bool> is_active_{false};
+    std::thread listener_thread_;
+    std::vector<std::thread> worker_threads_;
+    std::vector<std::thread> parser_threads_;
+    
+    struct parse_job {
+        std::string data;
+        std::string client_ip;
+        std::chrono::high_resolution_clock::time_point receive_time;
+    };
+    
+    // Reused across frames so steady-state parsing does not allocate
+    struct parse_context {
+        simple_json::json_document document;
+        beacon_message msg{};
+        batch_message batch{};
+        std::string inflate_buffer;     // Decompressed frames land here
+    };
+    
+    // One core's worth of listener: its own reuseport socket, event loop,
+    // framer and parser
+    struct alignas(64) listener_shard {
+        uint32_t id = 0;
+        int listen_fd = -1;
+        std::thread thread;
+        parse_context parser;
+    };
+    
+    // Largest JSON frame a TCP client may send, like binary_wire::max_body_size
+    static constexpr size_t max_json_frame = 1 << 20;
+    
+    // Per-connection framing state, owned by the one thread serving the socket
+    struct client_connection {
+        int fd = -1;
+        std::string client_ip;
+        uint16_t client_port = 0;
+        std::string message_buffer;
+        frame_scanner scanner;
+        listener_shard* shard = nullptr;
+        
+        // Frames still waiting for room in the parse queue, and when they arrived
+        std::vector<size_t> frame_ends;
+        std::chrono::high_resolution_clock::time_point received_at;
+        bool carried = false;
+        
+        // Decided by the first byte: JSON is framed by braces; binary frames
+        // and compressed envelopes by the length in their headers
+        enum class stream_mode { undecided, json, framed } mode = stream_mode::undecided;
     };
     
-    std::atomic<node*> head;
-    std::atomic<node*> tail;
+    // Datagram ingest; every datagram is already a whole frame
+    int udp_fd_ = -1;
+    std::unique_ptr<listener_shard> udp_shard_;
+    std::atomic<uint64_t> echo_replies_{0};
+    
+#ifdef __linux__
+    // Edge-triggered epoll event loops; each owns its connections outright
+    std::vector<std::thread> io_threads_;
+    std::vector<std::unique_ptr<listener_shard>> shards_;
+    int wake_fd_ = -1;
+    std::atomic<uint32_t> open_connections_{0};
+    static constexpr uint32_t read_budget = 16;   // recv calls per socket per wakeup
+    std::atomic<uint64_t> rejected_connections_{0};
+#endif
+    
+    mpmc_ring<parse_job> parse_queue_;
+    event_count parse_ready_;
+    
+    // Every decoded beacon and batch is republished here as JSON
+    std::unique_ptr<websocket_broadcaster> feed_;
+    
+    // ... and every decoded beacon, batched or not, as a fixed-layout record
+    std::unique_ptr<shm::ring_writer> shm_ring_;
+    
+    // ... and kept on disk for later queries
+    std::unique_ptr<history_store> history_;
+    
+    monitor_config config_;
+    sharded_stats stats_;
+    source_table sources_;
+    performance_counters perf_counters_;
     
 public:
-    lock_free_queue() {
-        node* dummy = new node;
-        head.store(dummy);
-        tail.store(dummy);
+    explicit network_listener_v3(const monitor_config& config) 
+        : config_(config), server_fd_(-1),
+          parse_queue_(config.queue_capacity, config.queue_overflow),
+          sources_(config.max_sources) {
+        initialize_socket();
+        
+        // Well-known names take the first ids
+        for (const char* name : {"whispr-lighthouse-v3", "heartbeat", "critical"}) string_interner::instance().intern(name);
+    }
+    
+    ~network_listener_v3() {
+        stop();
+        if (server_fd_ >= 0) close(server_fd_);
+    }
+    
+    bool initialize_socket() {
+        server_fd_ = open_listen_socket();
+        return server_fd_ >= 0;
+    }
+    
+    // SO_REUSEPORT lets every shard bind its own socket to the same port
+    int open_listen_socket() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ Socket creation failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            return -1;
+        }
+        
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        
+#ifndef _WIN32
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+#endif
+        
+        int rcvbuf = 1048576;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char*)&rcvbuf, sizeof(rcvbuf));
+        
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(config_.listen_port);
+        
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ Bind failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            close(fd);
+            return -1;
+        }
+        
+        if (listen(fd, config_.max_concurrent_connections) < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ Listen failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            close(fd);
+            return -1;
+        }
+        
+        return fd;
     }
     
-    ~lock_free_queue() {
-        while (node* old_head = head.load()) {
-            head.store(old_head->next);
-            delete old_head;
+    void start() {
+        if (is_active_.exchange(true)) return;
+        
+        if (config_.ws_port != 0) {
+            feed_ = std::make_unique<websocket_broadcaster>(config_.ws_port, config_.ws_client_queue);
+            if (!feed_->start()) feed_.reset();
+        }
+        
+        if (!config_.shm_name.empty()) {
+            shm_ring_ = std::make_unique<shm::ring_writer>();
+            uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+            if (!shm_ring_->create(config_.shm_name, config_.shm_records, now_ns)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Shared-memory ring " << config_.shm_name << " failed: " 
+                          << get_socket_error_string(errno) << ansi::RESET << std::endl;
+                shm_ring_.reset();
+            }
+        }
+        
+        if (!config_.history_dir.empty()) {
+            history_ = std::make_unique<history_store>(config_);
+            if (!history_->start()) history_.reset();
+        }
+        
+#ifdef __linux__
+        raise_fd_limit();
+        
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        
+        if (config_.listener_shards > 0) {
+            start_shards();
+        } else {
+            for (uint32_t i = 0; i < config_.parse_threads; ++i) {
+                parser_threads_.emplace_back([this, i]() {
+                    parser_worker(i);
+                });
+            }
+            
+            fcntl(server_fd_, F_SETFL, fcntl(server_fd_, F_GETFL, 0) | O_NONBLOCK);
+            
+            uint32_t io_count = std::max<uint32_t>(1, config_.io_threads);
+            for (uint32_t i = 0; i < io_count; ++i) {
+                io_threads_.emplace_back([this]() {
+                    io_loop(server_fd_, nullptr);
+                });
+            }
+        }
+#else
+        for (uint32_t i = 0; i < config_.parse_threads; ++i) {
+            parser_threads_.emplace_back([this, i]() {
+                parser_worker(i);
+            });
+        }
+        
+        listener_thread_ = std::thread([this]() {
+            accept_loop();
+        });
+#endif
+        
+        if (config_.udp_listen_port != 0 && open_udp_socket()) {
+            udp_shard_ = std::make_unique<listener_shard>();
+            udp_shard_->id = std::max(config_.parse_threads, config_.listener_shards);
+            udp_shard_->listen_fd = udp_fd_;
+            
+            listener_shard* raw = udp_shard_.get();
+            udp_shard_->thread = std::thread([this, raw]() {
+                udp_loop(raw);
+            });
         }
-    }
-    
-    void enqueue(T item) {
-        node* new_node = new node;
-        T* data = new T(std::move(item));
-        new_node->data.store(data);
         
-        node* prev_tail = tail.exchange(new_node);
-        prev_tail->next.store(new_node);
+        std::cout << ansi::BRIGHT_CYAN << ansi::WAVE << " Network listener V3 started - Port: " 
+                  << config_.listen_port;
+#ifdef __linux__
+        if (!shards_.empty()) {
+            std::cout << ", Shards: " << shards_.size() << " (pinned, inline parsing)";
+        } else {
+            std::cout << ", Parser threads: " << config_.parse_threads
+                      << ", I/O threads: " << std::max<uint32_t>(1, config_.io_threads);
+        }
+        std::cout << ", Max connections: " << config_.max_concurrent_connections;
+#else
+        std::cout << ", Parser threads: " << config_.parse_threads;
+#endif
+        if (udp_shard_) {
+            std::cout << ", UDP port: " << config_.udp_listen_port;
+        }
+        if (feed_) {
+            std::cout << ", WebSocket port: " << config_.ws_port;
+        }
+        if (shm_ring_) {
+            std::cout << ", Shared ring: /dev/shm/" << config_.shm_name << " (" << shm_ring_->capacity() << " records)";
+        }
+        if (history_) {
+            std::cout << ", History: " << config_.history_dir;
+        }
+        std::cout
+                  << ", SIMD validation: " << (config_.enable_simd_validation ? "ON" : "OFF") 
+                  << ansi::RESET << std::endl;
     }
     
-    bool dequeue(T& result) {
-        node* head_node = head.load();
-        node* next = head_node->next.load();
+    void stop() {
+        if (!is_active_.exchange(false)) return;
         
-        if (next == nullptr) return false;
+        parse_queue_.close();
+        parse_ready_.notify_all();
         
-        T* data = next->data.exchange(nullptr);
-        if (data != nullptr) {
-            result = std::move(*data);
-            delete data;
-            head.store(next);
-            delete head_node;
-            return true;
+#ifdef __linux__
+        if (wake_fd_ >= 0) {
+            uint64_t one = 1;
+            [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
         }
-        return false;
-    }
-};
-
-template<size_t Size>
-class string_pool {
-private:
-    std::vector<std::string> pool_;
-    std::mutex mutex_;
-    
-public:
-    string_pool() { pool_.reserve(Size); }
-    
-    std::string get_or_create(const std::string& str) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return str;
+        for (auto& io : io_threads_) {
+            if (io.joinable()) io.join();
+        }
+        io_threads_.clear();
+        
+        for (auto& shard : shards_) {
+            if (shard->thread.joinable()) shard->thread.join();
+            if (shard->listen_fd >= 0 && shard->listen_fd != server_fd_) {
+                close(shard->listen_fd);
+                shard->listen_fd = -1;
+            }
+        }
+        if (wake_fd_ >= 0) {
+            close(wake_fd_);
+            wake_fd_ = -1;
+        }
+#endif
+        
+        if (listener_thread_.joinable()) listener_thread_.join();
+        
+        if (udp_shard_ && udp_shard_->thread.joinable()) udp_shard_->thread.join();
+        if (udp_fd_ >= 0) {
+            close(udp_fd_);
+            udp_fd_ = -1;
+        }
+        
+        for (auto& worker : worker_threads_) {
+            if (worker.joinable()) worker.join();
+        }
+        
+        for (auto& parser : parser_threads_) {
+            if (parser.joinable()) parser.join();
+        }
+        
+        worker_threads_.clear();
+        parser_threads_.clear();
+        
+        if (feed_) feed_->stop();
+        shm_ring_.reset();     // Unlinks it; attached readers keep their mapping
+        if (history_) history_->stop();
+        
+        async_logger::instance().flush();
+        
+        auto final_stats = get_stats();
+        std::cout << ansi::BRIGHT_CYAN << "\n" << ansi::SPARKLE << " Final Performance Stats:" << ansi::RESET << "\n";
+        std::cout << ansi::YELLOW << "  Total packets: " << ansi::WHITE << final_stats.packets_received << "\n";
+        std::cout << ansi::YELLOW << "  Min parse time: " << ansi::WHITE << final_stats.min_parse_time_us << "μs\n";
+        std::cout << ansi::YELLOW << "  Max parse time: " << ansi::WHITE << final_stats.max_parse_time_us << "μs\n";
+        std::cout << ansi::YELLOW << "  Avg parse time: " << ansi::WHITE << final_stats.avg_parse_time_us << "μs\n";
+        std::cout << ansi::YELLOW << "  SIMD operations: " << ansi::WHITE << final_stats.simd_operations_count << ansi::RESET << "\n";
     }
-};
-
-// Enhanced beacon transmitter with beautiful output! 🌈
-class lighthouse_beacon_v3 {
-private:
-    int socket_fd_;
-    sockaddr_in destination_;
-    std::atomic<uint32_t> sequence_counter_{0};
-    std::atomic<uint32_t> batch_counter_{0};
-    std::atomic<bool> is_active_{false};
-    std::thread beacon_thread_;
-    std::thread batch_thread_;
-    
-    lock_free_queue<beacon_message> pending_messages_;
-    monitor_config config_;
-    performance_counters perf_counters_;
-    string_pool<4096> string_pool_;
     
-public:
-    explicit lighthouse_beacon_v3(const monitor_config& config) 
-        : config_(config), socket_fd_(-1) {
-        initialize_socket();
+    std::vector<source_summary> get_source_summaries(size_t limit) const {
+        uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        return sources_.snapshot(now_ns, limit);
     }
     
-    ~lighthouse_beacon_v3() {
-        stop();
-        if (socket_fd_ >= 0) close(socket_fd_);
+    network_stats get_stats() const {
+        network_stats current{};
+        
+        uint64_t parses = 0;
+        double parse_time_us = 0.0;
+        stats_.collect(current, parses, parse_time_us);
+        
+        if (parses > 0) {
+            current.avg_parse_time_us = parse_time_us / parses;
+        }
+        
+        current.queue_depth = parse_queue_.size();
+        current.queue_dropped = parse_queue_.dropped();
+        
+        if (feed_) {
+            auto feed = feed_->get_counters();
+            current.ws_viewers = feed.viewers;
+            current.ws_published = feed.published;
+            current.ws_dropped = feed.dropped;
+        }
+        if (shm_ring_) current.shm_published = shm_ring_->published();
+        current.sources_tracked = sources_.size();
+        current.sources_overflowed = sources_.overflowed();
+        current.strings_interned = string_interner::instance().size();
+        current.strings_overflowed = string_interner::instance().overflowed();
+        current.echo_replies = echo_replies_.load(std::memory_order_relaxed);
+        if (history_) {
+            auto history = history_->get_counters();
+            current.history_stored = history.stored;
+            current.history_dropped = history.dropped;
+            current.history_segments = history.segments;
+        }
+        
+        return current;
     }
     
-    bool initialize_socket() {
-        socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
-        if (socket_fd_ < 0) {
-            std::cerr << ansi::BRIGHT_RED << "❌ Socket creation failed: " 
+private:
+    bool open_udp_socket() {
+        udp_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (udp_fd_ < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ UDP socket creation failed: " 
                       << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
             return false;
         }
         
         int opt = 1;
-        setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        setsockopt(udp_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
         
-        int sndbuf = 1048576;
-        setsockopt(socket_fd_, SOL_SOCKET, SO_SNDBUF, (char*)&sndbuf, sizeof(sndbuf));
+        // Deep enough to ride out a burst while the previous one is parsed
+        int rcvbuf = 8 * 1048576;
+        setsockopt(udp_fd_, SOL_SOCKET, SO_RCVBUF, (char*)&rcvbuf, sizeof(rcvbuf));
+        
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(config_.udp_listen_port);
         
-        destination_.sin_family = AF_INET;
-        destination_.sin_port = htons(config_.target_port);
-        if (inet_pton(AF_INET, config_.target_host.c_str(), &destination_.sin_addr) <= 0) {
-            std::cerr << ansi::BRIGHT_RED << "❌ Invalid IP address: " << config_.target_host << ansi::RESET << std::endl;
+        if (bind(udp_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ UDP bind failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            close(udp_fd_);
+            udp_fd_ = -1;
             return false;
         }
         
+#ifdef __linux__
+        fcntl(udp_fd_, F_SETFL, fcntl(udp_fd_, F_GETFL, 0) | O_NONBLOCK);
+        if (config_.echo_replies) setsockopt(udp_fd_, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+#endif
         return true;
     }
     
-    void start() {
-        if (is_active_.exchange(true)) return;
-        
-        beacon_thread_ = std::thread([this]() { beacon_loop(); });
-        
-        if (config_.batch_size > 1) {
-            batch_thread_ = std::thread([this]() { batch_processor_loop(); });
-        }                                                     
-               
-  	    std::cout << ansi::BRIGHT_GREEN << ansi::LIGHTHOUSE << " Lighthouse beacon V3 activated - SIMD: " 
-                  << detect_simd_capability() << "-bit, Batch size: " << config_.batch_size 
-                  << ansi::RESET << std::endl;
-    }
-    
-    void stop() {
-        if (!is_active_.exchange(false)) return;
+    // A datagram skips the framer and is parsed inline on the receiving thread.
+    // Returns the newest sender timestamp in it, 0 if nothing decoded.
+    uint64_t ingest_datagram(listener_shard& shard, const char* data, size_t length,
+                             const sockaddr_in& sender, uint32_t& last_sender, std::string& client_ip,
+                             std::chrono::high_resolution_clock::time_point receive_time) {
+        if (sender.sin_addr.s_addr != last_sender || client_ip.empty()) {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &sender.sin_addr, ip, INET_ADDRSTRLEN);
+            client_ip = ip;
+            last_sender = sender.sin_addr.s_addr;
+        }
         
-        if (beacon_thread_.joinable()) beacon_thread_.join();
-        if (batch_thread_.joinable()) batch_thread_.join();
+        uint64_t origin_ns = process_frame(shard.parser, std::string_view(data, length), client_ip, shard.id, receive_time);
         
-        std::cout << ansi::BRIGHT_CYAN << "\n" << ansi::SPARKLE << " Performance Summary:" << ansi::RESET << "\n";
-        std::cout << ansi::YELLOW << "  SIMD String Ops: " << ansi::WHITE << perf_counters_.simd_string_ops.load() << "\n";
-        std::cout << ansi::YELLOW << "  SIMD Number Ops: " << ansi::WHITE << perf_counters_.simd_number_ops.load() << "\n";
-        std::cout << ansi::YELLOW << "  Allocations Saved: " << ansi::WHITE << perf_counters_.allocations_saved.load() << "\n";
-        std::cout << ansi::YELLOW << "  Branch Predictions Saved: " << ansi::WHITE << perf_counters_.branch_predictions_saved.load() << ansi::RESET << "\n";
+        stats_shard& stats = stats_.local();
+        stats.packets_received.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes_received.fetch_add(length, std::memory_order_relaxed);
+        return origin_ns;
     }
     
-    uint32_t get_sequence_counter() const { return sequence_counter_.load(); }
-    
-private:
-    void beacon_loop() {
-        auto next_beacon = std::chrono::steady_clock::now();
-        
-        while (is_active_.load()) {
-            auto now = std::chrono::steady_clock::now();
-            
-            if (now >= next_beacon) {
-                create_and_queue_beacon();
-                next_beacon = now + std::chrono::milliseconds(config_.beacon_interval_ms);
-            }
-            
-            std::this_thread::sleep_until(next_beacon);
-        }
+    static uint64_t to_ns(std::chrono::high_resolution_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
     }
     
-    void create_and_queue_beacon() {
-        beacon_message msg{};
+#ifdef __linux__
+    // Drains the socket with recvmmsg into a fixed array of datagram slots,
+    // then sleeps in poll until more arrive or the wake fd fires
+    void udp_loop(listener_shard* shard) {
+        constexpr size_t batch_slots = 64;
+        constexpr size_t slot_capacity = 65536;
         
-        msg.source_id = "whispr-lighthouse-v3";
-        msg.message_type = "heartbeat";
-        msg.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        std::vector<char> storage(batch_slots * slot_capacity);
+        std::vector<mmsghdr> headers(batch_slots);
+        std::vector<iovec> slots(batch_slots);
+        std::vector<sockaddr_in> senders(batch_slots);
         
-        std::ostringstream payload_builder;
-        payload_builder << "Lighthouse V3 - SIMD:" << detect_simd_capability() 
-                       << " Seq:" << sequence_counter_.load();
+        for (size_t i = 0; i < batch_slots; ++i) {
+            slots[i].iov_base = storage.data() + i * slot_capacity;
+            slots[i].iov_len = slot_capacity;
+            headers[i].msg_hdr.msg_iov = &slots[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+            headers[i].msg_hdr.msg_name = &senders[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
         
-        msg.payload = payload_builder.str();
-        msg.sequence_number = sequence_counter_.fetch_add(1);
-        msg.is_critical = (msg.sequence_number % 100 == 0);
-        msg.simd_capability = detect_simd_capability();
-        msg.parse_time_us = 0.0;
-        msg.message_size = 0;
+        pollfd waiters[2] = {{udp_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        uint32_t last_sender = 0;
+        std::string client_ip;
         
-        perf_counters_.allocations_saved.fetch_add(3);
+        // Echo replies for one receive batch go back in one sendmmsg, with
+        // the kernel's arrival stamps as their receive times
+        std::vector<receive_stamp_buffer> stamps(config_.echo_replies ? batch_slots : 0);
+        std::vector<echo_wire::pong> pongs(batch_slots);
+        std::vector<std::array<char, echo_wire::pong_size>> pong_bytes(batch_slots);
+        std::vector<iovec> pong_slots(batch_slots);
+        std::vector<mmsghdr> pong_headers(batch_slots);
         
-        if (config_.batch_size > 1) {
-            pending_messages_.enqueue(std::move(msg));
-        } else {
-            send_single_beacon(msg);
-        }
-    }
-    
-    void batch_processor_loop() {
         while (is_active_.load()) {
-            batch_message batch{};
-            batch.batch_id = batch_counter_.fetch_add(1);
-            batch.messages.reserve(config_.batch_size);
+            for (size_t i = 0; i < stamps.size(); ++i) {
+                headers[i].msg_hdr.msg_control = stamps[i].bytes;
+                headers[i].msg_hdr.msg_controllen = sizeof(stamps[i].bytes);
+            }
+            int received = recvmmsg(udp_fd_, headers.data(), batch_slots, MSG_DONTWAIT, nullptr);
             
-            beacon_message msg;
-            while (batch.messages.size() < config_.batch_size && 
-                   pending_messages_.dequeue(msg)) {
-                batch.messages.emplace_back(std::move(msg));
+            if (received <= 0) {
+                if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                             << "❌ UDP receive failed: " << get_socket_error_string(errno) 
+                             << ansi::RESET << std::endl;
+                    break;
+                }
+                poll(waiters, 2, -1);
+                continue;
             }
             
-            if (!batch.messages.empty()) {
-                send_batch(batch);
+            auto receive_time = std::chrono::high_resolution_clock::now();
+            size_t replies = 0;
+            for (int i = 0; i < received; ++i) {
+                // Truncated datagrams cannot hold a whole frame
+                if (!(headers[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+                    uint64_t origin_ns = ingest_datagram(*shard, static_cast<const char*>(slots[i].iov_base), 
+                                                         headers[i].msg_len, senders[i], last_sender, client_ip, receive_time);
+                    if (config_.echo_replies && origin_ns != 0) {
+                        pongs[replies] = {origin_ns, kernel_receive_ns(headers[i].msg_hdr, to_ns(receive_time)), 0};
+                        pong_headers[replies] = mmsghdr{};
+                        pong_headers[replies].msg_hdr.msg_name = &senders[i];
+                        pong_headers[replies].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                        replies++;
+                    }
+                }
+                headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
             }
             
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (replies > 0) {
+                // Stamped as late as possible so the peer's RTT excludes our parse time
+                uint64_t transmit_ns = to_ns(std::chrono::high_resolution_clock::now());
+                for (size_t r = 0; r < replies; ++r) {
+                    pongs[r].transmit_ns = transmit_ns;
+                    echo_wire::encode(pongs[r], pong_bytes[r].data());
+                    pong_slots[r] = {pong_bytes[r].data(), pong_bytes[r].size()};
+                    pong_headers[r].msg_hdr.msg_iov = &pong_slots[r];
+                    pong_headers[r].msg_hdr.msg_iovlen = 1;
+                }
+                int sent = sendmmsg(udp_fd_, pong_headers.data(), static_cast<unsigned int>(replies), MSG_DONTWAIT);
+                if (sent > 0) echo_replies_.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+            }
         }
     }
-    
-    void send_single_beacon(const beacon_message& msg) {
-        auto start_time = std::chrono::high_resolution_clock::now();
-        
-        std::string json_output = msg.to_json().to_string();
-        const_cast<beacon_message&>(msg).message_size = json_output.size();
+#else
+    void udp_loop(listener_shard* shard) {
+        std::vector<char> datagram(65536);
+        uint32_t last_sender = 0;
+        std::string client_ip;
         
-        auto serialize_time = std::chrono::high_resolution_clock::now();
-        auto serialize_us = std::chrono::duration_cast<std::chrono::microseconds>(
-            serialize_time - start_time).count();
-        
-        int bytes_sent = sendto(socket_fd_, 
-                               json_output.data(), 
-                               json_output.size(), 
-                               MSG_DONTWAIT,
-                               reinterpret_cast<sockaddr*>(&destination_), 
-                               sizeof(destination_));
-        
-        if (bytes_sent > 0) {
-            std::cout << ansi::BRIGHT_BLUE << "[" << format::timestamp_now() << "] " 
-                     << ansi::GREEN << ansi::ROCKET << " Beacon #" << msg.sequence_number 
-                     << " sent (" << bytes_sent << " bytes, " 
-                     << serialize_us << "μs serialize)" << ansi::RESET << std::endl;
-            
-            perf_counters_.simd_string_ops.fetch_add(1);
-        } else {
-            std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
-                     << "❌ Send failed: " << get_socket_error_string(get_last_socket_error()) 
-                     << ansi::RESET << std::endl;
+        while (is_active_.load()) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(udp_fd_, &readable);
+            timeval timeout{0, 100000};
+            
+            if (select(static_cast<int>(udp_fd_) + 1, &readable, nullptr, nullptr, &timeout) <= 0) continue;
+            
+            sockaddr_in sender{};
+            socklen_t sender_len = sizeof(sender);
+            int length = recvfrom(udp_fd_, datagram.data(), static_cast<int>(datagram.size()), 0,
+                                  reinterpret_cast<sockaddr*>(&sender), &sender_len);
+            if (length <= 0) continue;
+            
+            auto receive_time = std::chrono::high_resolution_clock::now();
+            uint64_t origin_ns = ingest_datagram(*shard, datagram.data(), static_cast<size_t>(length), 
+                                                 sender, last_sender, client_ip, receive_time);
+            if (config_.echo_replies && origin_ns != 0) {
+                char pong[echo_wire::pong_size];
+                echo_wire::encode({origin_ns, to_ns(receive_time), to_ns(std::chrono::high_resolution_clock::now())}, pong);
+                if (sendto(udp_fd_, pong, sizeof(pong), 0, reinterpret_cast<const sockaddr*>(&sender), sender_len) > 0) {
+                    echo_replies_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
         }
     }
+#endif
     
-    void send_batch(const batch_message& batch) {
-        auto start_time = std::chrono::high_resolution_clock::now();
+    // Length of the length-prefixed frame at the front of data: a binary
+    // frame or a compressed envelope, each of which may follow the other
+    static size_t framed_size(std::string_view data) {
+        if (data.empty()) return 0;
+        return static_cast<uint8_t>(data[0]) == frame_codec::compressed_magic 
+            ? frame_codec::envelope_size(data) : binary_wire::frame_size(data);
+    }
+    
+    // Frames newly received bytes and hands complete frames to the parser pool.
+    // Returns false when the stream can no longer be framed and must be closed.
+    // A reactor passes may_wait = false; frames it cannot queue stay pending.
+    bool ingest(client_connection& conn, const char* data, size_t length,
+                std::chrono::high_resolution_clock::time_point receive_time, bool may_wait) {
+        conn.message_buffer.append(data, length);
+        conn.received_at = receive_time;
         
-        std::string json_output = batch.to_json().to_string();
+        stats_shard& stats = stats_.local();
+        stats.packets_received.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes_received.fetch_add(length, std::memory_order_relaxed);
         
-        const_cast<batch_message&>(batch).compression_ratio = 
-            (batch.messages.size() * 400) * 100 / json_output.size();
+        using stream_mode = client_connection::stream_mode;
+        bool corrupt = conn.mode == stream_mode::undecided && !open_stream(conn);
+        if (corrupt || conn.mode == stream_mode::undecided) {
+            if (corrupt) {
+                std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                         << "[" << conn.client_ip << "] " 
+                         << "❌ Corrupt binary stream, closing connection" << ansi::RESET << std::endl;
+            }
+            return !corrupt;
+        }
         
-        auto serialize_time = std::chrono::high_resolution_clock::now();
-        auto serialize_us = std::chrono::duration_cast<std::chrono::microseconds>(
-            serialize_time - start_time).count();
-        
-        int bytes_sent = sendto(socket_fd_, 
-                               json_output.data(), 
-                               json_output.size(), 
-                               MSG_DONTWAIT,
-                               reinterpret_cast<sockaddr*>(&destination_), 
-                               sizeof(destination_));
-        
-        if (bytes_sent > 0) {
-            std::cout << ansi::BRIGHT_MAGENTA << "[" << format::timestamp_now() << "] " 
-                     << ansi::FIRE << " Batch #" << batch.batch_id 
-                     << " sent (" << batch.messages.size() << " messages, "
-                     << bytes_sent << " bytes, " 
-                     << serialize_us << "μs serialize, "
-                     << batch.compression_ratio << "% compression)" << ansi::RESET << std::endl;
-            
-            perf_counters_.simd_string_ops.fetch_add(batch.messages.size());
-            perf_counters_.allocations_saved.fetch_add(batch.messages.size() * 2);
+        std::vector<size_t>& frame_ends = conn.frame_ends;
+        if (conn.mode == stream_mode::framed) {
+            // Frames ahead of a bad header are still delivered
+            size_t end = frame_ends.empty() ? 0 : frame_ends.back();
+            while (true) {
+                size_t frame_size = framed_size(std::string_view(conn.message_buffer).substr(end));
+                if (frame_size == SIZE_MAX) {
+                    std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                             << "[" << conn.client_ip << "] " 
+                             << "❌ Corrupt binary stream, closing connection" << ansi::RESET << std::endl;
+                    corrupt = true;
+                    break;
+                }
+                if (frame_size == 0 || frame_size > conn.message_buffer.size() - end) break;
+                end += frame_size;
+                frame_ends.push_back(end);
+            }
         } else {
-            std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
-                     << "❌ Batch send failed: " << get_socket_error_string(get_last_socket_error()) 
-                     << ansi::RESET << std::endl;
+            // Only the newly received bytes are scanned; state carries over
+            conn.scanner.scan(conn.message_buffer, frame_ends);
+            
+            // An unclosed or over-closed frame would otherwise grow the buffer forever
+            size_t unframed = conn.message_buffer.size() - (frame_ends.empty() ? 0 : frame_ends.back());
+            if (conn.scanner.unbalanced() || unframed > max_json_frame) {
+                std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                         << "[" << conn.client_ip << "] " 
+                         << "❌ Unbalanced or oversized JSON stream, closing connection" << ansi::RESET << std::endl;
+                corrupt = true;
+            }
         }
+        
+        deliver_frames(conn, may_wait);
+        return !corrupt;
     }
-};
-
-// Enhanced multi-threaded listener with beautiful output! 
-class network_listener_v3 {
-private:
-    int server_fd_;
-    std::atomic<bool> is_active_{false};
-    std::thread listener_thread_;
-    std::vector<std::thread> worker_threads_;
-    std::vector<std::thread> parser_threads_;
-    
-    struct parse_job {
-        std::string data;
-        std::string client_ip;
-        std::chrono::high_resolution_clock::time_point receive_time;
-    };
-    
-    lock_free_queue<parse_job> parse_queue_;
-    string_pool<16384> shared_string_pool_;
-    std::mutex string_pool_mutex_;
-    
-    monitor_config config_;
-    std::atomic<network_stats> stats_{};
-    performance_counters perf_counters_;
-    
-    std::atomic<double> total_parse_time_us_{0.0};
-    std::atomic<uint64_t> total_parses_{0};
     
-public:
-    explicit network_listener_v3(const monitor_config& config) 
-        : config_(config), server_fd_(-1) {
-        initialize_socket();
+    // Decides the stream's framing from its first byte: JSON is framed by
+    // braces; binary frames and compressed envelopes by their headers. A
+    // binary client may open with hello frames to agree on a version; each
+    // is answered here and the mode follows from whatever comes after it.
+    // Returns false on a hello that cannot be read.
+    bool open_stream(client_connection& conn) {
+        using stream_mode = client_connection::stream_mode;
         
-        {
-            std::lock_guard<std::mutex> lock(string_pool_mutex_);
-            shared_string_pool_.get_or_create("heartbeat");
-            shared_string_pool_.get_or_create("critical");
-            shared_string_pool_.get_or_create("whispr-lighthouse-v3");
+        while (!conn.message_buffer.empty()) {
+            uint8_t first = static_cast<uint8_t>(conn.message_buffer[0]);
+            if (first != binary_wire::magic) {
+                conn.mode = (first == frame_codec::compressed_magic) ? stream_mode::framed : stream_mode::json;
+                return true;
+            }
+            if (conn.message_buffer.size() < binary_wire::header_size) return true;
+            if (static_cast<binary_wire::record>(static_cast<uint8_t>(conn.message_buffer[2])) != binary_wire::record::hello) {
+                conn.mode = stream_mode::framed;
+                return true;
+            }
+            
+            size_t size = binary_wire::frame_size(conn.message_buffer);
+            if (size == SIZE_MAX) return false;
+            if (size > conn.message_buffer.size()) return true;
+            
+            int chosen = binary_wire::negotiate(std::string_view(conn.message_buffer).substr(0, size));
+            if (chosen < 0) return false;
+            
+            std::string reply;
+            if (chosen > 0) {
+                binary_wire::serialize_hello(reply, {static_cast<uint8_t>(chosen)});
+            } else {
+                binary_wire::serialize_hello(reply, {});
+            }
+#ifdef MSG_NOSIGNAL
+            send(conn.fd, reply.data(), static_cast<int>(reply.size()), MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+            send(conn.fd, reply.data(), static_cast<int>(reply.size()), MSG_DONTWAIT);
+#endif
+            conn.message_buffer.erase(0, size);
         }
+        return true;
     }
     
-    ~network_listener_v3() {
-        stop();
-        if (server_fd_ >= 0) close(server_fd_);
-    }
-    
-    bool initialize_socket() {
-        server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd_ < 0) {
-            std::cerr << ansi::BRIGHT_RED << "❌ Socket creation failed: " 
-                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
-            return false;
-        }
+    // Hands the connection's complete frames to the parsers. Under the block
+    // policy a caller that may not wait stops at a full queue and keeps the
+    // rest in conn.frame_ends; until they drain it should stop reading, so
+    // TCP pushes back on the sender instead of the reactor stalling.
+    void deliver_frames(client_connection& conn, bool may_wait) {
+        bool stall = !may_wait && !conn.shard && config_.queue_overflow == overflow_policy::block;
+        size_t start = 0;
+        size_t delivered = 0;
         
-        int opt = 1;
-        setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        for (; delivered < conn.frame_ends.size(); ++delivered) {
+            size_t end = conn.frame_ends[delivered];
+            if (conn.shard) {
+                // Sharded: parse right here, the frame never leaves this core
+                std::string_view frame(conn.message_buffer.data() + start, end - start);
+                process_frame(conn.shard->parser, frame, conn.client_ip, conn.shard->id, conn.received_at);
+            } else {
+                parse_job job;
+                job.data.assign(conn.message_buffer.data() + start, end - start);
+                job.client_ip = conn.client_ip;
+                job.receive_time = conn.received_at;
+                
+                bool queued = stall ? parse_queue_.try_push(std::move(job)) : parse_queue_.push(std::move(job));
+                if (queued) {
+                    parse_ready_.notify_one();
+                } else if (stall) {
+                    break;
+                }
+            }
+            
+            start = end;
+            perf_counters_.branch_predictions_saved.fetch_add(1);
+        }
         
-#ifndef _WIN32
-        setsockopt(server_fd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
-        setsockopt(server_fd_, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
-#endif
+        conn.frame_ends.erase(conn.frame_ends.begin(), conn.frame_ends.begin() + delivered);
+        for (size_t& end : conn.frame_ends) end -= start;
         
-        int rcvbuf = 1048576;
-        setsockopt(server_fd_, SOL_SOCKET, SO_RCVBUF, (char*)&rcvbuf, sizeof(rcvbuf));
+        if (start > 0) {
+            conn.message_buffer.erase(0, start);
+            if (conn.mode == client_connection::stream_mode::json) conn.scanner.consume(start);
+        }
+    }
+    
+    void on_client_connected(const client_connection& conn) {
+        stats_.local().active_connections.fetch_add(1, std::memory_order_relaxed);
         
-        sockaddr_in address{};
-        address.sin_family = AF_INET;
-        address.sin_addr.s_addr = INADDR_ANY;
-        address.sin_port = htons(config_.listen_port);
+        std::cout << ansi::BRIGHT_GREEN << "[" << format::timestamp_now() << "] " 
+                  << "🔗 Client connected: " << ansi::BRIGHT_WHITE << conn.client_ip 
+                  << ":" << conn.client_port << ansi::RESET << std::endl;
+    }
+    
+    void on_client_disconnected(const client_connection& conn) {
+        stats_.local().active_connections.fetch_sub(1, std::memory_order_relaxed);
         
-        if (bind(server_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
-            std::cerr << ansi::BRIGHT_RED << "❌ Bind failed: " 
-                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
-            return false;
-        }
+        std::cout << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                  << "🔌 Client disconnected: " << ansi::BRIGHT_WHITE << conn.client_ip 
+                  << ansi::RESET << std::endl;
+    }
+    
+#ifdef __linux__
+    // Tens of thousands of sockets need more than the usual 1024 descriptors
+    void raise_fd_limit() {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
         
-        if (listen(server_fd_, config_.max_concurrent_connections) < 0) {
-            std::cerr << ansi::BRIGHT_RED << "❌ Listen failed: " 
-                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
-            return false;
-        }
+        rlim_t wanted = static_cast<rlim_t>(config_.max_concurrent_connections) + 1024;
+        if (limit.rlim_max != RLIM_INFINITY) wanted = std::min(wanted, limit.rlim_max);
+        if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= wanted) return;
         
-        return true;
+        limit.rlim_cur = wanted;
+        setrlimit(RLIMIT_NOFILE, &limit);
     }
     
-    void start() {
-        if (is_active_.exchange(true)) return;
+    void start_shards() {
+        uint32_t cpu_count = std::max(1u, std::thread::hardware_concurrency());
         
-        for (uint32_t i = 0; i < config_.parse_threads; ++i) {
-            parser_threads_.emplace_back([this, i]() {
-                parser_worker(i);
+        for (uint32_t i = 0; i < config_.listener_shards; ++i) {
+            auto shard = std::make_unique<listener_shard>();
+            shard->id = i;
+            shard->listen_fd = (i == 0) ? server_fd_ : open_listen_socket();
+            if (shard->listen_fd < 0) break;
+            
+            fcntl(shard->listen_fd, F_SETFL, fcntl(shard->listen_fd, F_GETFL, 0) | O_NONBLOCK);
+            
+            uint32_t cpu = i % cpu_count;
+#ifdef SO_INCOMING_CPU
+            // Ask the reuseport group to prefer this socket for flows arriving on its core
+            int incoming_cpu = static_cast<int>(cpu);
+            setsockopt(shard->listen_fd, SOL_SOCKET, SO_INCOMING_CPU, &incoming_cpu, sizeof(incoming_cpu));
+#endif
+            
+            listener_shard* raw = shard.get();
+            shard->thread = std::thread([this, raw]() {
+                io_loop(raw->listen_fd, raw);
             });
+            
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            pthread_setaffinity_np(shard->thread.native_handle(), sizeof(cpus), &cpus);
+            
+            shards_.push_back(std::move(shard));
         }
-        
-        listener_thread_ = std::thread([this]() {
-            accept_loop();
-        });
-        
-        std::cout << ansi::BRIGHT_CYAN << ansi::WAVE << " Network listener V3 started - Port: " 
-                  << config_.listen_port << ", Parser threads: " << config_.parse_threads
-                  << ", SIMD validation: " << (config_.enable_simd_validation ? "ON" : "OFF") 
-                  << ansi::RESET << std::endl;
     }
     
-    void stop() {
-        if (!is_active_.exchange(false)) return;
+    // One edge-triggered event loop. A shared listening socket is registered in
+    // every loop with EPOLLEXCLUSIVE, so each accept lands on exactly one thread
+    // and the connection stays there for its whole life. A shard's loop owns
+    // its own reuseport socket instead and parses inline.
+    void io_loop(int listen_fd, listener_shard* shard) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            std::cerr << ansi::BRIGHT_RED << "❌ epoll_create1 failed: " 
+                      << get_socket_error_string(get_last_socket_error()) << ansi::RESET << std::endl;
+            return;
+        }
         
-        if (listener_thread_.joinable()) listener_thread_.join();
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listen_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
         
-        for (auto& worker : worker_threads_) {
-            if (worker.joinable()) worker.join();
-        }
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd_;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd_, &ev);
         
-        for (auto& parser : parser_threads_) {
-            if (parser.joinable()) parser.join();
-        }
+        std::unordered_map<int, std::unique_ptr<client_connection>> connections;
+        std::vector<char> buffer(65536);
+        epoll_event events[256];
         
-        worker_threads_.clear();
-        parser_threads_.clear();
+        // Sockets to serve again without a new edge: their read budget ran out
+        // or their frames are waiting for room in the parse queue
+        std::vector<int> carried;
+        std::vector<int> retry;
+        bool budget_spent = false;
         
-        auto final_stats = stats_.load();
-        std::cout << ansi::BRIGHT_CYAN << "\n" << ansi::SPARKLE << " Final Performance Stats:" << ansi::RESET << "\n";
-        std::cout << ansi::YELLOW << "  Total packets: " << ansi::WHITE << final_stats.packets_received << "\n";
-        std::cout << ansi::YELLOW << "  Min parse time: " << ansi::WHITE << final_stats.min_parse_time_us << "μs\n";
-        std::cout << ansi::YELLOW << "  Max parse time: " << ansi::WHITE << final_stats.max_parse_time_us << "μs\n";
-        std::cout << ansi::YELLOW << "  Avg parse time: " << ansi::WHITE << final_stats.avg_parse_time_us << "μs\n";
-        std::cout << ansi::YELLOW << "  SIMD operations: " << ansi::WHITE << final_stats.simd_operations_count << ansi::RESET << "\n";
-    }
-    
-    network_stats get_stats() const {
-        auto current = stats_.load();
+        // Spare descriptor given up to shed a connection when the table is full
+        int reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
         
-        uint64_t parses = total_parses_.load();
-        if (parses > 0) {
-            current.avg_parse_time_us = total_parse_time_us_.load() / parses;
+        auto close_connection = [&](int fd) {
+            auto it = connections.find(fd);
+            if (it == connections.end()) return;
+            
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            on_client_disconnected(*it->second);
+            connections.erase(it);
+            open_connections_.fetch_sub(1);
+        };
+        
+        auto carry = [&](client_connection& conn) {
+            if (conn.carried) return;
+            conn.carried = true;
+            carried.push_back(conn.fd);
+        };
+        
+        // Edge-triggered: read until the kernel has nothing more, but at most
+        // read_budget times so one flooding client cannot starve the rest
+        auto serve = [&](client_connection& conn, bool closed) {
+            if (!conn.frame_ends.empty()) {
+                deliver_frames(conn, false);
+                if (!conn.frame_ends.empty()) {
+                    carry(conn);
+                    return;
+                }
+            }
+            
+            for (uint32_t reads = 0; !closed; ++reads) {
+                if (reads == read_budget) {
+                    budget_spent = true;
+                    carry(conn);
+                    break;
+                }
+                
+                ssize_t bytes_received = recv(conn.fd, buffer.data(), buffer.size(), 0);
+                
+                if (bytes_received > 0) {
+                    closed = !ingest(conn, buffer.data(), static_cast<size_t>(bytes_received),
+                                     std::chrono::high_resolution_clock::now(), false);
+                    if (!closed && !conn.frame_ends.empty()) {
+                        // Parse queue full: leave the rest in the socket for now
+                        carry(conn);
+                        break;
+                    }
+                } else if (bytes_received == 0) {
+                    closed = true;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                } else if (errno != EINTR) {
+                    std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                             << "❌ Receive failed: " << get_socket_error_string(errno) 
+                             << ansi::RESET << std::endl;
+                    closed = true;
+                }
+            }
+            
+            if (closed) {
+                close_connection(conn.fd);
+            } else if (conn.message_buffer.empty() && conn.message_buffer.capacity() > 65536) {
+                // Give back memory a large frame left behind so idle sockets stay small
+                conn.message_buffer.shrink_to_fit();
+            }
+        };
+        
+        while (is_active_.load()) {
+            // Carried sockets still have unread data, so don't sleep on them;
+            // ones only waiting on the parsers get a short pause instead
+            int timeout = carried.empty() ? -1 : (budget_spent ? 0 : 1);
+            int ready = epoll_wait(epoll_fd, events, 256, timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            
+            retry.swap(carried);
+            carried.clear();
+            budget_spent = false;
+            for (int fd : retry) {
+                auto it = connections.find(fd);
+                if (it != connections.end()) it->second->carried = false;
+            }
+            
+            for (int e = 0; e < ready; ++e) {
+                int fd = events[e].data.fd;
+                
+                if (fd == wake_fd_) continue;
+                
+                if (fd == listen_fd) {
+                    accept_ready(epoll_fd, listen_fd, shard, connections, reserve_fd);
+                    continue;
+                }
+                
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                serve(*it->second, (events[e].events & (EPOLLHUP | EPOLLERR)) != 0);
+            }
+            
+            // Served after fresh events so waiting sockets get their turn too
+            for (int fd : retry) {
+                auto it = connections.find(fd);
+                if (it == connections.end() || it->second->carried) continue;
+                serve(*it->second, false);
+            }
         }
         
-        return current;
+        while (!connections.empty()) {
+            close_connection(connections.begin()->first);
+        }
+        if (reserve_fd >= 0) close(reserve_fd);
+        close(epoll_fd);
     }
     
-private:
+    void accept_ready(int epoll_fd, int listen_fd, listener_shard* shard,
+                      std::unordered_map<int, std::unique_ptr<client_connection>>& connections,
+                      int& reserve_fd) {
+        // Bounded so one loop cannot hog a connection storm
+        for (int accepted = 0; accepted < 64; ++accepted) {
+            sockaddr_in client_addr{};
+            socklen_t client_len = sizeof(client_addr);
+            
+            int client_fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&client_addr), 
+                                    &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                if (errno != EMFILE && errno != ENFILE) break;
+                
+                // Out of descriptors, and the level-triggered listen socket
+                // would wake us again at once: shed the connection with the
+                // spare descriptor, or back off if even that is gone
+                if (reserve_fd >= 0) {
+                    close(reserve_fd);
+                    int shed = accept(listen_fd, nullptr, nullptr);
+                    if (shed >= 0) {
+                        close(shed);
+                        rejected_connections_.fetch_add(1);
+                    }
+                    reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                }
+                if (reserve_fd < 0) {
+                    reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                break;
+            }
+            
+            if (open_connections_.load() >= config_.max_concurrent_connections) {
+                close(client_fd);
+                rejected_connections_.fetch_add(1);
+                continue;
+            }
+            
+            int opt = 1;
+            setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            
+            auto conn = std::make_unique<client_connection>();
+            conn->fd = client_fd;
+            char client_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+            conn->client_ip = client_ip;
+            conn->client_port = ntohs(client_addr.sin_port);
+            conn->shard = shard;
+            
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = client_fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+                close(client_fd);
+                continue;
+            }
+            
+            open_connections_.fetch_add(1);
+            on_client_connected(*conn);
+            connections.emplace(client_fd, std::move(conn));
+        }
+    }
+#else
+    // Thread-per-connection fallback for platforms without epoll
     void accept_loop() {
         while (is_active_.load()) {
             sockaddr_in client_addr{};
@@ -1077,84 +6835,30 @@ private:
                 worker_threads_.emplace_back([this, client_fd, client_addr]() {
                     handle_client(client_fd, client_addr);
                 });
-                
-                auto current_stats = stats_.load();
-                current_stats.active_connections++;
-                stats_.store(current_stats);
             }
         }
     }
     
     void handle_client(int client_fd, const sockaddr_in& client_addr) {
+        client_connection conn;
+        conn.fd = client_fd;
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        conn.client_ip = client_ip;
+        conn.client_port = ntohs(client_addr.sin_port);
+        conn.message_buffer.reserve(8192);
         
-        std::cout << ansi::BRIGHT_GREEN << "[" << format::timestamp_now() << "] " 
-                  << "🔗 Client connected: " << ansi::BRIGHT_WHITE << client_ip 
-                  << ":" << ntohs(client_addr.sin_port) << ansi::RESET << std::endl;
+        on_client_connected(conn);
         
         alignas(64) char buffer[65536];
-        std::string message_buffer;
-        message_buffer.reserve(8192);
         
         while (is_active_.load()) {
-            int bytes_received = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
+            int bytes_received = recv(client_fd, buffer, sizeof(buffer), 0);
             
             if (bytes_received > 0) {
-                buffer[bytes_received] = '\0';
-                auto receive_time = std::chrono::high_resolution_clock::now();
-                
-                message_buffer.append(buffer, bytes_received);
-                
-                size_t start = 0;
-                int brace_count = 0;
-                bool in_string = false;
-                bool escape_next = false;
-                
-                for (size_t i = 0; i < message_buffer.size(); ++i) {
-                    char c = message_buffer[i];
-                    
-                    if (!escape_next) {
-                        if (c == '"' && !in_string) {
-                            in_string = true;
-                        } else if (c == '"' && in_string) {
-                            in_string = false;
-                        } else if (c == '\\' && in_string) {
-                            escape_next = true;
-                            continue;
-                        } else if (!in_string) {
-                            if (c == '{') brace_count++;
-                            else if (c == '}') {
-                                brace_count--;
-                                if (brace_count == 0) {
-                                    parse_job job;
-                                    job.data = std::string(message_buffer.data() + start, i - start + 1);
-                                    job.client_ip = client_ip;
-                                    job.receive_time = receive_time;
-                                    
-                                    parse_queue_.enqueue(std::move(job));
-                                    
-                                    start = i + 1;
-                                    perf_counters_.branch_predictions_saved.fetch_add(1);
-                                }
-                            }
-                        }
-                    } else {
-                        escape_next = false;
-                    }
-                }
-                
-                if (start < message_buffer.size()) {
-                    message_buffer = message_buffer.substr(start);
-                } else {
-                    message_buffer.clear();
-                }
-                
-                auto current_stats = stats_.load();
-                current_stats.packets_received++;
-                current_stats.bytes_transmitted += bytes_received;
-                stats_.store(current_stats);
-                
+                // Its own thread, so waiting on a full parse queue is fine here
+                if (!ingest(conn, buffer, static_cast<size_t>(bytes_received),
+                            std::chrono::high_resolution_clock::now(), true)) break;
             } else if (bytes_received == 0) {
                 break;
             } else {
@@ -1173,133 +6877,210 @@ private:
         }
         
         close(client_fd);
-        
-        auto current_stats = stats_.load();
-        current_stats.active_connections--;
-        stats_.store(current_stats);
-        
-        std::cout << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
-                  << "🔌 Client disconnected: " << ansi::BRIGHT_WHITE << client_ip 
-                  << ansi::RESET << std::endl;
+        on_client_disconnected(conn);
     }
+#endif
     
     void parser_worker(uint32_t thread_id) {
         std::cout << ansi::BRIGHT_YELLOW << "[" << format::timestamp_now() << "] " 
                   << "⚡ Parser thread " << thread_id << " started (SIMD: " 
                   << detect_simd_capability() << "-bit)" << ansi::RESET << std::endl;
         
-        while (is_active_.load()) {
-            parse_job job;
+        parse_context context;
+        parse_job job;
+        
+        // Spinning only pays when the producer runs on another core
+        const uint32_t spin_limit = std::thread::hardware_concurrency() > 1 ? 2048 : 0;
+        
+        while (is_active_.load(std::memory_order_relaxed)) {
+            bool popped = parse_queue_.try_pop(job);
+            for (uint32_t spin = 0; !popped && spin < spin_limit; ++spin) {
+                cpu_relax();
+                popped = parse_queue_.try_pop(job);
+            }
             
-            if (parse_queue_.dequeue(job)) {
-                auto parse_start = std::chrono::high_resolution_clock::now();
+            if (!popped) {
+                uint32_t key = parse_ready_.prepare_wait();
+                popped = parse_queue_.try_pop(job);
+                if (popped || !is_active_.load()) {
+                    parse_ready_.cancel_wait();
+                } else {
+                    parse_ready_.wait(key);
+                }
+            }
+            
+            if (popped) process_frame(context, job.data, job.client_ip, thread_id, job.receive_time);
+        }
+    }
+    
+    // Returns the newest sender timestamp decoded, 0 if none
+    uint64_t process_frame(parse_context& context, std::string_view frame, const std::string& client_ip,
+                           uint32_t thread_id, std::chrono::high_resolution_clock::time_point receive_time) {
+        beacon_message& msg = context.msg;
+        batch_message& batch = context.batch;
+        uint64_t newest_ns = 0;
+        auto parse_start = std::chrono::high_resolution_clock::now();
+        
+        stats_shard& stats = stats_.local();
+        stats.queue_delay.record(static_cast<uint64_t>(std::max<int64_t>(0, 
+            std::chrono::duration_cast<std::chrono::nanoseconds>(parse_start - receive_time).count())));
+        
+        try {
+            // Compressed frames are inflated into the context's buffer and parsed from there
+            std::string_view frame_text = frame;
+            size_t wire_size = frame.size();
+            if (!frame.empty() && static_cast<uint8_t>(frame[0]) == frame_codec::compressed_magic &&
+                !frame_codec::decompress(frame, context.inflate_buffer, frame_text)) {
+                std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                         << "[Thread " << thread_id << "] " 
+                         << "[" << client_ip << "] " 
+                         << "❌ Corrupt compressed frame" << ansi::RESET << std::endl;
+                return 0;
+            }
+            
+            bool binary = !frame_text.empty() && static_cast<uint8_t>(frame_text[0]) == binary_wire::magic;
+            auto kind = binary ? binary_wire::decode(frame_text, msg, batch) 
+                               : wire_decoder::decode(frame_text, msg, batch);
+            
+            // Viewers get the sender's JSON untouched when the fast path accepted it
+            bool verbatim = !binary && kind != wire_decoder::frame_kind::malformed;
+            
+            if (kind == wire_decoder::frame_kind::malformed && !binary) {
+                // Outside the fast path's grammar - let the lenient DOM parser decide
+                context.document.parse(std::string(frame_text));
+                simple_json::json_view json_obj = context.document.root();
+                
+                if (json_obj.has("source_id") && json_obj.has("message_type")) {
+                    msg = beacon_message::from_json(json_obj);
+                    kind = wire_decoder::frame_kind::beacon;
+                } else if (json_obj.has("batch_id") && json_obj.has("messages")) {
+                    batch = batch_message::from_json(json_obj);
+                    kind = wire_decoder::frame_kind::batch;
+                }
+            }
+            
+            if (kind == wire_decoder::frame_kind::beacon) {
+                
+                auto parse_end = std::chrono::high_resolution_clock::now();
+                double parse_us = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    parse_end - parse_start).count() / 1000.0;
+                
+                msg.parse_time_us = parse_us;
+                stats.record_parse(parse_us);
+                
+                uint64_t current_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+                double latency_ms = (current_ns - msg.timestamp_ns) / 1000000.0;
+                stats.record_latency(msg.timestamp_ns, current_ns);
+                sources_.record(msg.source_id, msg.sequence_number, msg.timestamp_ns, current_ns);
+                newest_ns = msg.timestamp_ns;
+                if (shm_ring_) publish_to_ring(msg, client_ip, current_ns, parse_us);
+                if (history_) history_->append(msg, client_ip, current_ns, parse_us);
+                
+                async_logger& logger = async_logger::instance();
+                if (log_record* record = logger.begin(log_event::beacon_received, log_level::info)) {
+                    record->thread_id = thread_id;
+                    record->set_peer(client_ip);
+                    record->id = msg.sequence_number;
+                    record->set_label(msg.message_type.view());
+                    record->critical = msg.is_critical;
+                    record->time_us = parse_us;
+                    record->latency_ms = latency_ms;
+                    logger.commit();
+                }
+                
+                if (feed_ && feed_->has_viewers()) publish_to_viewers(frame_text, verbatim, msg);
+                
+                perf_counters_.simd_string_ops.fetch_add(1);
                 
-                try {
-                    simple_json::json_value json_obj = simple_json::json_value::parse(job.data);
+            } else if (kind == wire_decoder::frame_kind::batch) {
+                auto parse_end = std::chrono::high_resolution_clock::now();
+                double parse_us = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    parse_end - parse_start).count() / 1000.0;
+                
+                stats.record_parse(parse_us);
+                
+                // The sender's figure is about its own JSON; report what this frame really saved
+                if (frame_text.size() != wire_size) {
+                    batch.compression_ratio = frame_text.size() * 100 / wire_size;
+                }
+                
+                async_logger& logger = async_logger::instance();
+                if (log_record* record = logger.begin(log_event::batch_received, log_level::info)) {
+                    record->thread_id = thread_id;
+                    record->set_peer(client_ip);
+                    record->id = batch.batch_id;
+                    record->messages = batch.messages.size();
+                    record->time_us = parse_us;
+                    record->compression_ratio = batch.compression_ratio;
+                    logger.commit();
+                }
+                
+                for (const auto& batch_msg : batch.messages) {
+                    uint64_t current_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+                    double latency_ms = (current_ns - batch_msg.timestamp_ns) / 1000000.0;
+                    stats.record_latency(batch_msg.timestamp_ns, current_ns);
+                    sources_.record(batch_msg.source_id, batch_msg.sequence_number, batch_msg.timestamp_ns, current_ns);
+                    newest_ns = std::max(newest_ns, batch_msg.timestamp_ns);
+                    if (shm_ring_) publish_to_ring(batch_msg, client_ip, current_ns, parse_us);
+                    if (history_) history_->append(batch_msg, client_ip, current_ns, parse_us);
                     
-                    if (json_obj.has("source_id") && json_obj.has("message_type")) {
-                        beacon_message msg = beacon_message::from_json(json_obj);
-                        
-                        auto parse_end = std::chrono::high_resolution_clock::now();
-                        double parse_us = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            parse_end - parse_start).count() / 1000.0;
-                        
-                        msg.parse_time_us = parse_us;
-                        update_parse_stats(parse_us);
-                        
-                        uint64_t current_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                        double latency_ms = (current_ns - msg.timestamp_ns) / 1000000.0;
-                        
-                        std::cout << ansi::BRIGHT_CYAN << "[" << format::timestamp_now() << "] " 
-                                 << "[Thread " << thread_id << "] " 
-                                 << "[" << ansi::BRIGHT_WHITE << job.client_ip << ansi::BRIGHT_CYAN << "] " 
-                                 << ansi::SPARKLE << " Beacon #" << msg.sequence_number 
-                                 << " (Type: " << ansi::YELLOW << msg.message_type << ansi::BRIGHT_CYAN
-                                 << ", Critical: " << (msg.is_critical ? ansi::BRIGHT_RED + std::string("YES") : ansi::GREEN + std::string("NO")) << ansi::BRIGHT_CYAN
-                                 << ", Parse: " << ansi::WHITE << parse_us << "μs" << ansi::BRIGHT_CYAN
-                                 << ", Latency: " << ansi::WHITE << latency_ms << "ms" << ansi::BRIGHT_CYAN << ")" 
-                                 << ansi::RESET << std::endl;
-                        
-                        perf_counters_.simd_string_ops.fetch_add(1);
-                        
-                    } else if (json_obj.has("batch_id") && json_obj.has("messages")) {
-                        batch_message batch = batch_message::from_json(json_obj);
-                        
-                        auto parse_end = std::chrono::high_resolution_clock::now();
-                        double parse_us = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            parse_end - parse_start).count() / 1000.0;
-                        
-                        update_parse_stats(parse_us);
-                        
-                        std::cout << ansi::BRIGHT_MAGENTA << "[" << format::timestamp_now() << "] " 
-                                 << "[Thread " << thread_id << "] " 
-                                 << "[" << ansi::BRIGHT_WHITE << job.client_ip << ansi::BRIGHT_MAGENTA << "] " 
-                                 << ansi::FIRE << " Batch #" << batch.batch_id 
-                                 << " (" << batch.messages.size() << " messages, "
-                                 << "Parse: " << ansi::WHITE << parse_us << "μs" << ansi::BRIGHT_MAGENTA << ", "
-                                 << "Compression: " << ansi::WHITE << batch.compression_ratio << "%" << ansi::BRIGHT_MAGENTA << ")" 
-                                 << ansi::RESET << std::endl;
-                        
-                        for (const auto& batch_msg : batch.messages) {
-                            uint64_t current_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                            double latency_ms = (current_ns - batch_msg.timestamp_ns) / 1000000.0;
-                            
-                            if (batch_msg.is_critical) {
-                                std::cout << ansi::BRIGHT_RED << "  → Critical message in batch: Seq #" 
-                                         << batch_msg.sequence_number 
-                                         << ", Latency: " << latency_ms << "ms" << ansi::RESET << std::endl;
-                            }
-                        }
-                        
-                        perf_counters_.simd_string_ops.fetch_add(batch.messages.size());
-                        perf_counters_.allocations_saved.fetch_add(batch.messages.size() * 3);
-                        
-                    } else {
-                        std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
-                                 << "[Thread " << thread_id << "] " 
-                                 << "[" << job.client_ip << "] " 
-                                 << "❌ Unknown message format" << ansi::RESET << std::endl;
+                    if (!batch_msg.is_critical) continue;
+                    if (log_record* record = logger.begin(log_event::critical_in_batch, log_level::warn)) {
+                        record->id = batch_msg.sequence_number;
+                        record->latency_ms = latency_ms;
+                        logger.commit();
                     }
-                    
-                } catch (const std::exception& e) {
-                    std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
-                             << "[Thread " << thread_id << "] " 
-                             << "[" << job.client_ip << "] " 
-                             << "❌ Parse error: " << e.what() << ansi::RESET << std::endl;
                 }
                 
+                if (feed_ && feed_->has_viewers()) publish_to_viewers(frame_text, verbatim, batch);
+                
+                perf_counters_.simd_string_ops.fetch_add(batch.messages.size());
+                perf_counters_.allocations_saved.fetch_add(batch.messages.size() * 3);
+                
             } else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                         << "[Thread " << thread_id << "] " 
+                         << "[" << client_ip << "] " 
+                         << "❌ Unknown message format" << ansi::RESET << std::endl;
             }
+            
+        } catch (const std::exception& e) {
+            std::cerr << ansi::BRIGHT_RED << "[" << format::timestamp_now() << "] " 
+                     << "[Thread " << thread_id << "] " 
+                     << "[" << client_ip << "] " 
+                     << "❌ Parse error: " << e.what() << ansi::RESET << std::endl;
         }
+        return newest_ns;
     }
     
-    void update_parse_stats(double parse_us) {
-        total_parse_time_us_.fetch_add(parse_us);
-        total_parses_.fetch_add(1);
-        
-        auto current_stats = stats_.load();
-        
-        double current_min = current_stats.min_parse_time_us;
-        double current_max = current_stats.max_parse_time_us;
-        
-        if (current_min == 0.0 || parse_us < current_min) {
-            current_stats.min_parse_time_us = parse_us;
-        }
-        
-        if (parse_us > current_max) {
-            current_stats.max_parse_time_us = parse_us;
-        }
-        
-        if (parse_us < 10.0) {
-            current_stats.cache_hits++;
-        } else {
-            current_stats.cache_misses++;
+    void publish_to_ring(const beacon_message& msg, const std::string& client_ip,
+                         uint64_t received_ns, double parse_us) {
+        shm_ring_->publish([&](shm::beacon_record& record) {
+            record.timestamp_ns = msg.timestamp_ns;
+            record.received_ns = received_ns;
+            record.sequence_number = msg.sequence_number;
+            record.parse_time_us = parse_us;
+            record.message_size = msg.message_size;
+            record.simd_capability = msg.simd_capability;
+            record.is_critical = msg.is_critical;
+            shm::copy_field(record.source_id, msg.source_id.view());
+            shm::copy_field(record.message_type, msg.message_type.view());
+            shm::copy_field(record.peer, client_ip);
+        });
+    }
+    
+    // Browsers only speak JSON, so binary and DOM-parsed frames are re-encoded
+    template<typename Message>
+    void publish_to_viewers(std::string_view frame_text, bool verbatim, const Message& message) {
+        if (verbatim) {
+            feed_->publish(frame_text);
+            return;
         }
-        
-        stats_.store(current_stats);
+        std::string& json = wire_encoder::thread_buffer();
+        wire_encoder::serialize(message, json);
+        feed_->publish(json);
     }
 };
 
@@ -1327,6 +7108,8 @@ public:
         
         print_banner();
         
+        async_logger::instance().configure(config_.min_log_level, config_.log_sample_tx, config_.log_sample_rx);
+        
         beacon_ = std::make_unique<lighthouse_beacon_v3>(config_);
         listener_ = std::make_unique<network_listener_v3>(config_);
         
@@ -1397,7 +7180,13 @@ private:
         std::cout << ansi::CYAN << "SIMD Capability: " << ansi::WHITE << detect_simd_capability() << "-bit" << ansi::RESET << std::endl;
         std::cout << ansi::CYAN << "Parse Threads: " << ansi::WHITE << config_.parse_threads << ansi::RESET << std::endl;
         std::cout << ansi::CYAN << "Batch Size: " << ansi::WHITE << config_.batch_size << ansi::RESET << std::endl;
-        std::cout << ansi::CYAN << "Target: " << ansi::WHITE << config_.target_host << ":" << config_.target_port << ansi::RESET << std::endl;
+        if (config_.destinations.empty()) {
+            std::cout << ansi::CYAN << "Target: " << ansi::WHITE << config_.target_host << ":" << config_.target_port << ansi::RESET << std::endl;
+        } else {
+            for (const auto& destination : config_.destinations) {
+                std::cout << ansi::CYAN << "Destination: " << ansi::WHITE << destination << ansi::RESET << std::endl;
+            }
+        }
         std::cout << ansi::CYAN << "Listen Port: " << ansi::WHITE << config_.listen_port << ansi::RESET << std::endl;
         std::cout << ansi::BRIGHT_CYAN << "════════════════════════════════════════════════════════════════\n" << ansi::RESET << std::endl;
     }
@@ -1469,6 +7258,35 @@ private:
         for (int i = 0; i < 15; ++i) std::cout << " ";
         std::cout << ansi::WHITE << "║\n";
         
+        // Latency percentiles over the recent window; μ is two bytes but one column
+        std::string window_title = "LATENCY (μs, last " + std::to_string(std::lround(stats.window_seconds)) + "s)";
+        std::cout << ansi::BRIGHT_WHITE << "║ " << ansi::BRIGHT_GREEN << window_title 
+                  << std::string(24 - window_title.size(), ' ') << ansi::WHITE
+                  << "     p50     p90     p99   p99.9     max   life p99 ║\n";
+        draw_latency_row("Parse", stats.parse_time);
+        draw_latency_row("Queue wait", stats.queue_delay);
+        draw_latency_row("One-way", stats.beacon_latency);
+        
+        // Busiest sources over the last minute, with the hour for comparison
+        auto sources = listener_ ? listener_->get_source_summaries(5) : std::vector<source_summary>{};
+        if (!sources.empty()) {
+            std::cout << ansi::BRIGHT_WHITE << "║ " << ansi::BRIGHT_GREEN << std::left << std::setw(23) << "SOURCES (ms, last 1m)"
+                      << std::right << ansi::WHITE << std::setw(8) << "count" << std::setw(8) << "lost" 
+                      << std::setw(8) << "reord" << std::setw(8) << "jitter" << std::setw(8) << "p99" 
+                      << std::setw(11) << "1h p99" << " ║\n";
+            for (const auto& source : sources) draw_source_row(source);
+        }
+        
+        // Round trips to each destination; one-way here has the clock offset taken out
+        auto clocks = beacon_ ? beacon_->get_clock_summaries() : std::vector<clock_summary>{};
+        if (!clocks.empty()) {
+            std::cout << ansi::BRIGHT_WHITE << "║ " << ansi::BRIGHT_GREEN << std::left << std::setw(23) << "CLOCK SYNC (ms)"
+                      << std::right << ansi::WHITE << std::setw(8) << "rtt" << std::setw(10) << "offset" 
+                      << std::setw(8) << "ppm" << std::setw(8) << "1w p50" << std::setw(8) << "1w p99" 
+                      << std::setw(9) << "pongs" << " ║\n";
+            for (const auto& clock : clocks) draw_clock_row(clock);
+        }
+        
         // Configuration
         std::cout << ansi::BRIGHT_CYAN;
         std::cout << "╠════════════════════════════════════════════════════════════════════════════╣\n";
@@ -1525,6 +7343,73 @@ private:
         std::cout << "\033[J" << std::flush;
     }
     
+    void draw_latency_row(const char* label, const latency_view& view) {
+        const latency_summary& w = view.window;
+        std::cout << "║ " << ansi::YELLOW << std::left << std::setw(23) << label << std::right << ansi::WHITE 
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(8) << w.p50_us << std::setw(8) << w.p90_us << std::setw(8) << w.p99_us 
+                  << std::setw(8) << w.p999_us << std::setw(8) << w.max_us 
+                  << ansi::BRIGHT_BLACK << std::setw(11) << view.lifetime.p99_us << ansi::WHITE << " ║\n"
+                  << std::defaultfloat;
+    }
+    
+    void draw_source_row(const source_summary& source) {
+        const rollup_summary& m = source.minute;
+        std::cout << "║ " << ansi::YELLOW << std::left << std::setw(23) << format::truncate(source.source_id, 22) 
+                  << std::right << ansi::WHITE << std::fixed << std::setprecision(1)
+                  << std::setw(8) << m.count << (m.lost > 0 ? ansi::BRIGHT_RED : ansi::WHITE) << std::setw(8) << m.lost 
+                  << ansi::WHITE << std::setw(8) << source.delivery.reordered << std::setw(8) << source.delivery.jitter_ms 
+                  << std::setw(8) << m.p99_ms 
+                  << ansi::BRIGHT_BLACK << std::setw(11) << source.hour.p99_ms << ansi::WHITE << " ║\n"
+                  << std::defaultfloat;
+    }
+    
+    void draw_clock_row(const clock_summary& clock) {
+        std::cout << "║ " << ansi::YELLOW << std::left << std::setw(23) << format::truncate(clock.name, 22) 
+                  << std::right << ansi::WHITE << std::fixed << std::setprecision(3)
+                  << std::setw(8) << clock.rtt_us / 1000.0 << std::setw(10) << clock.offset_us / 1000.0 
+                  << std::setprecision(1) << std::setw(8) << clock.drift_ppm 
+                  << std::setprecision(3) << std::setw(8) << clock.one_way.p50_us / 1000.0 
+                  << std::setw(8) << clock.one_way.p99_us / 1000.0 
+                  << ansi::BRIGHT_BLACK << std::setw(9) << clock.samples << ansi::WHITE << " ║\n"
+                  << std::defaultfloat;
+    }
+    
+    void print_source_rows(const source_summary& source) {
+        auto row = [](const std::string& name, const char* span, const rollup_summary& summary) {
+            std::cout << ansi::YELLOW << "  " << std::left << std::setw(11) << name << std::setw(9) << span 
+                      << std::right << ansi::WHITE << std::setw(10) << summary.count << std::setw(10) << summary.lost 
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(10) << summary.min_ms << std::setw(10) << summary.mean_ms 
+                      << std::setw(10) << summary.p50_ms << std::setw(10) << summary.p99_ms 
+                      << std::setw(10) << summary.max_ms << std::defaultfloat << ansi::RESET << std::endl;
+        };
+        row(format::truncate(source.source_id, 10), "1s", source.second);
+        row("", "1m", source.minute);
+        row("", "1h", source.hour);
+        
+        const sequence_summary& d = source.delivery;
+        std::cout << ansi::BRIGHT_BLACK << std::string(13, ' ') << "lifetime: " << d.received << " received, " 
+                  << d.lost << " lost, " << d.duplicates << " duplicate, " << d.reordered << " reordered, " 
+                  << d.late << " late, jitter " << std::fixed << std::setprecision(3) << d.jitter_ms << "ms"
+                  << std::defaultfloat << ansi::RESET << std::endl;
+    }
+    
+    void print_latency_rows(const char* label, const latency_view& view, double window_seconds) {
+        auto row = [](const char* name, const char* span, const latency_summary& summary) {
+            std::cout << ansi::YELLOW << "  " << std::left << std::setw(11) << name << std::setw(9) << span 
+                      << std::right << ansi::WHITE << std::fixed << std::setprecision(1)
+                      << std::setw(10) << summary.p50_us << std::setw(10) << summary.p90_us 
+                      << std::setw(10) << summary.p99_us << std::setw(10) << summary.p999_us 
+                      << std::setw(10) << summary.max_us << std::setw(12) << summary.count 
+                      << std::defaultfloat << ansi::RESET << std::endl;
+        };
+        
+        std::string window_label = "last " + std::to_string(std::lround(window_seconds)) + "s";
+        row(label, "total", view.lifetime);
+        row("", window_label.c_str(), view.window);
+    }
+    
     void monitor_loop() {
         auto last_report = std::chrono::steady_clock::now();
         
@@ -1545,6 +7430,10 @@ private:
         
         auto stats = listener_->get_stats();
         
+        // Queued log lines go out first so the report is not split by them
+        async_logger& logger = async_logger::instance();
+        logger.flush();
+        
         std::cout << ansi::BRIGHT_CYAN << "\n" << ansi::WAVE << "─── Performance Report ───" << ansi::RESET << std::endl;
         std::cout << ansi::YELLOW << "Packets Received: " << ansi::WHITE << stats.packets_received << ansi::RESET << std::endl;
         std::cout << ansi::YELLOW << "Bytes Transmitted: " << ansi::WHITE << format::format_bytes(stats.bytes_transmitted) << ansi::RESET << std::endl;
@@ -1554,6 +7443,80 @@ private:
                   << ", Max=" << stats.max_parse_time_us 
                   << ", Avg=" << stats.avg_parse_time_us << ansi::RESET << std::endl;
         std::cout << ansi::YELLOW << "SIMD Operations: " << ansi::WHITE << stats.simd_operations_count << ansi::RESET << std::endl;
+        std::cout << ansi::YELLOW << "Latency (μs):" << std::string(9, ' ') << ansi::WHITE
+                  << "       p50       p90       p99     p99.9       max       count" << ansi::RESET << std::endl;
+        print_latency_rows("Parse", stats.parse_time, stats.window_seconds);
+        print_latency_rows("Queue wait", stats.queue_delay, stats.window_seconds);
+        print_latency_rows("One-way", stats.beacon_latency, stats.window_seconds);
+        
+        auto sources = listener_->get_source_summaries(5);
+        if (!sources.empty()) {
+            std::cout << ansi::YELLOW << "Sources (ms):" << std::string(9, ' ') << ansi::WHITE
+                      << "     count      lost       min      mean       p50       p99       max" << ansi::RESET << std::endl;
+            for (const auto& source : sources) print_source_rows(source);
+            std::cout << ansi::YELLOW << "  " << stats.sources_tracked << " sources tracked" << ansi::WHITE
+                      << ", " << stats.strings_interned << " names interned";
+            if (stats.sources_overflowed > 0) std::cout << ", " << stats.sources_overflowed << " beacons from untracked sources";
+            if (stats.strings_overflowed > 0) std::cout << ", " << stats.strings_overflowed << " names the interner had no room for";
+            std::cout << ansi::RESET << std::endl;
+        }
+        
+        std::cout << ansi::YELLOW << "Parse Queue: " << ansi::WHITE << stats.queue_depth << "/" << config_.queue_capacity
+                  << " queued, " << stats.queue_dropped << " dropped" << ansi::RESET << std::endl;
+        
+        if (beacon_) {
+            auto tx = beacon_->get_tx_stats();
+            double per_syscall = tx.tx_syscalls > 0 ? static_cast<double>(tx.packets_sent) / tx.tx_syscalls : 0.0;
+            std::cout << ansi::YELLOW << "Transmit: " << ansi::WHITE << tx.packets_sent << " datagrams in "
+                      << tx.tx_syscalls << " syscalls (" << std::setprecision(3) << per_syscall 
+                      << " per syscall, GSO " << (tx.tx_gso ? "on" : "off") << "), "
+                      << tx.tx_errors << " errors" << ansi::RESET << std::endl;
+            
+            auto destinations = beacon_->get_destination_stats();
+            if (destinations.size() > 1) {
+                for (const auto& destination : destinations) {
+                    std::cout << ansi::YELLOW << "  → " << destination.name << ": " << ansi::WHITE 
+                              << destination.sent << " sent, " << destination.errors << " errors" 
+                              << ansi::RESET << std::endl;
+                }
+            }
+            
+            for (const auto& clock : beacon_->get_clock_summaries()) {
+                if (clock.samples == 0) {
+                    std::cout << ansi::YELLOW << "  ⇄ " << clock.name << ": " << ansi::WHITE << "no pongs yet" << ansi::RESET << std::endl;
+                    continue;
+                }
+                std::cout << ansi::YELLOW << "  ⇄ " << clock.name << ": " << ansi::WHITE << std::fixed << std::setprecision(1)
+                          << "rtt " << clock.rtt_us << "μs (min " << clock.min_rtt_us << "), offset " << clock.offset_us 
+                          << "μs, drift " << std::setprecision(2) << clock.drift_ppm << "ppm, one-way p50 " 
+                          << std::setprecision(1) << clock.one_way.p50_us << "μs p99 " << clock.one_way.p99_us 
+                          << "μs, " << clock.samples << " pongs" << std::defaultfloat << ansi::RESET << std::endl;
+            }
+        }
+        
+        if (config_.echo_replies) {
+            std::cout << ansi::YELLOW << "Echo: " << ansi::WHITE << stats.echo_replies << " pongs sent" << ansi::RESET << std::endl;
+        }
+        
+        if (!config_.shm_name.empty()) {
+            std::cout << ansi::YELLOW << "Shared Ring: " << ansi::WHITE << stats.shm_published << " records published to /dev/shm/"
+                      << config_.shm_name << ansi::RESET << std::endl;
+        }
+        
+        if (!config_.history_dir.empty()) {
+            std::cout << ansi::YELLOW << "History: " << ansi::WHITE << stats.history_stored << " stored, "
+                      << stats.history_dropped << " dropped, " << stats.history_segments << " segments in "
+                      << config_.history_dir << ansi::RESET << std::endl;
+        }
+        
+        if (config_.ws_port != 0) {
+            std::cout << ansi::YELLOW << "WebSocket Feed: " << ansi::WHITE << stats.ws_viewers << " viewers, "
+                      << stats.ws_published << " published, " << stats.ws_dropped << " dropped" << ansi::RESET << std::endl;
+        }
+        
+        auto log = logger.stats();
+        std::cout << ansi::YELLOW << "Log Records: " << ansi::WHITE << log.written << " written, "
+                  << log.sampled_out << " sampled out, " << log.dropped << " dropped" << ansi::RESET << std::endl;
         
         if ((stats.cache_hits + stats.cache_misses) > 0) {
             std::cout << ansi::YELLOW << "Cache Hit Rate: " << ansi::WHITE
@@ -1578,25 +7541,146 @@ void signal_handler(int signal) {
     std::exit(0);
 }
 
+// Reference consumer for the shared ring: follows the newest records and
+// reports any it was too slow to see
+int tail_shared_ring(const std::string& name) {
+    whispr::shm::ring_reader reader;
+    if (!reader.open(name)) {
+        std::cerr << ansi::BRIGHT_RED << "❌ No shared ring named " << name << ansi::RESET << std::endl;
+        return 1;
+    }
+    
+    std::cout << ansi::BRIGHT_CYAN << ansi::WAVE << " Tailing /dev/shm/" << name << " (" 
+              << reader.capacity() << " records)" << ansi::RESET << std::endl;
+    
+    whispr::shm::beacon_record record;
+    uint64_t reported_lost = 0;
+    while (true) {
+        switch (reader.next(record)) {
+            case whispr::shm::read_status::record:
+                std::cout << (record.is_critical ? ansi::BRIGHT_RED : ansi::BRIGHT_GREEN) 
+                          << "[" << format::timestamp_now() << "] " << "📡 " << record.source_id 
+                          << " #" << record.sequence_number << " " << record.message_type 
+                          << " from " << record.peer << " (" 
+                          << (static_cast<int64_t>(record.received_ns - record.timestamp_ns) / 1000000.0) 
+                          << "ms)" << ansi::RESET << "\n";
+                break;
+            case whispr::shm::read_status::overrun:
+                std::cout << ansi::BRIGHT_YELLOW << "⚠️ Fell behind, skipped " 
+                          << (reader.lost() - reported_lost) << " records" << ansi::RESET << "\n";
+                reported_lost = reader.lost();
+                break;
+            case whispr::shm::read_status::empty:
+                std::cout << std::flush;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                break;
+        }
+    }
+}
+
+// Answers "what did SOURCE look like over this window" from the history store
+int query_history(const std::string& directory, const std::string& spec) {
+    using whispr::network::destination_option;
+    
+    std::string options = "," + spec;
+    std::string since = destination_option(options, "since");
+    std::string until = destination_option(options, "until");
+    std::string source = destination_option(options, "source");
+    std::string limit_text = destination_option(options, "limit");
+    size_t limit = limit_text.empty() ? 10 : std::stoul(limit_text);
+    
+    uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t from_ns = since.empty() ? 0 : now_ns - std::min(now_ns, whispr::network::parse_duration_us(since) * 1000);
+    uint64_t to_ns = until.empty() ? std::numeric_limits<uint64_t>::max() 
+                                   : now_ns - std::min(now_ns, whispr::network::parse_duration_us(until) * 1000);
+    
+    uint64_t matched = 0, critical = 0;
+    int64_t min_latency = std::numeric_limits<int64_t>::max(), max_latency = std::numeric_limits<int64_t>::min();
+    double latency_sum = 0.0;
+    std::deque<whispr::network::history_record> recent;
+    
+    auto scan_start = std::chrono::steady_clock::now();
+    size_t segments = whispr::network::scan_history(directory, from_ns, to_ns, 
+        [&](const whispr::network::history_record& record) {
+            if (!source.empty() && source != record.source_id) return;
+            
+            int64_t latency = static_cast<int64_t>(record.received_ns - record.timestamp_ns);
+            min_latency = std::min(min_latency, latency);
+            max_latency = std::max(max_latency, latency);
+            latency_sum += latency;
+            matched++;
+            if (record.flags & whispr::network::history_record::critical) critical++;
+            
+            if (limit > 0) {
+                if (recent.size() == limit) recent.pop_front();
+                recent.push_back(record);
+            }
+        });
+    double scan_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scan_start).count();
+    
+    std::cout << ansi::BRIGHT_CYAN << "🔎 History in " << directory << ": " << ansi::WHITE << matched 
+              << " beacons" << (source.empty() ? "" : " from " + source) 
+              << " (" << critical << " critical), " << segments << " segments scanned in " 
+              << std::fixed << std::setprecision(2) << scan_ms << "ms" << ansi::RESET << std::endl;
+    if (matched == 0) return 0;
+    
+    std::cout << ansi::YELLOW << "Latency (ms): " << ansi::WHITE << std::setprecision(3)
+              << "min " << min_latency / 1e6 << ", avg " << latency_sum / matched / 1e6 
+              << ", max " << max_latency / 1e6 << ansi::RESET << std::endl;
+    
+    for (const auto& record : recent) {
+        std::cout << (record.flags & whispr::network::history_record::critical ? ansi::BRIGHT_RED : ansi::GREEN)
+                  << "[" << format::timestamp_of(record.received_ns) << "] " << record.source_id 
+                  << " #" << record.sequence_number << " " << record.message_type << " from " << record.peer 
+                  << " (" << static_cast<int64_t>(record.received_ns - record.timestamp_ns) / 1e6 << "ms)" 
+                  << ansi::RESET << "\n";
+    }
+    return 0;
+}
+
 // Main entry point
+// Test builds include this file for its classes and bring their own main
+#ifndef LITEHAUS_NO_MAIN
 int main(int argc, char* argv[]) {
     // Default configuration
     whispr::network::monitor_config config{
         .target_host = "127.0.0.1",
         .target_port = 9001,
+        .destinations = {},
         .listen_port = 9000,
         .beacon_interval_ms = 1000,
-        .max_concurrent_connections = 100,
+        .max_concurrent_connections = 10000,
         .enable_compression = true,
         .enable_encryption = false,
         .batch_size = 10,
         .enable_simd_validation = true,
         .enable_prefetch = true,
         .parse_threads = std::thread::hardware_concurrency(),
-        .string_pool_size = 16384
+        .queue_capacity = 65536,
+        .queue_overflow = whispr::network::overflow_policy::block,
+        .io_threads = 2,
+        .listener_shards = 0,
+        .udp_listen_port = 9001,
+        .batch_linger_us = 10000,
+        .beacon_templates = false,
+        .beacon_wire = whispr::network::wire_format::json,
+        .min_log_level = whispr::network::log_level::info,
+        .log_sample_tx = 1,
+        .log_sample_rx = 1,
+        .ws_port = 8083,
+        .ws_client_queue = 256,
+        .shm_name = "",
+        .shm_records = 65536,
+        .max_sources = 131072,
+        .history_dir = "",
+        .history_segment_mb = 64,
+        .history_segment_age_us = 3600000000ULL,
+        .history_retention_us = 7 * 86400000000ULL
     };
     
     bool dashboard_mode = false;
+    std::string history_query;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -1614,6 +7698,90 @@ int main(int argc, char* argv[]) {
             config.batch_size = static_cast<uint32_t>(std::stoi(argv[++i]));
         } else if (arg == "--parse-threads" && i + 1 < argc) {
             config.parse_threads = static_cast<uint32_t>(std::stoi(argv[++i]));
+        } else if (arg == "--io-threads" && i + 1 < argc) {
+            config.io_threads = static_cast<uint32_t>(std::stoi(argv[++i]));
+        } else if (arg == "--template-beacons") {
+            config.beacon_templates = true;
+        } else if (arg == "--wire" && i + 1 < argc) {
+            if (!whispr::network::parse_wire_format(argv[++i], config.beacon_wire)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Unknown wire format: " << argv[i] << ansi::RESET << std::endl;
+                return 1;
+            }
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            if (!whispr::network::parse_log_level(argv[++i], config.min_log_level)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Unknown log level: " << argv[i] << ansi::RESET << std::endl;
+                return 1;
+            }
+        } else if (arg == "--log-sample" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            std::string category = spec.substr(0, eq);
+            uint32_t every = eq == std::string::npos ? 0 : static_cast<uint32_t>(std::stoul(spec.substr(eq + 1)));
+            if (category == "tx" && every > 0) config.log_sample_tx = every;
+            else if (category == "rx" && every > 0) config.log_sample_rx = every;
+            else {
+                std::cerr << ansi::BRIGHT_RED << "❌ Invalid log sampling: " << spec << ansi::RESET << std::endl;
+                return 1;
+            }
+        } else if (arg == "--no-compression") {
+            config.enable_compression = false;
+        } else if (arg == "--linger-us" && i + 1 < argc) {
+            config.batch_linger_us = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--dest" && i + 1 < argc) {
+            config.destinations.push_back(argv[++i]);
+        } else if (arg == "--udp-port" && i + 1 < argc) {
+            config.udp_listen_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+        } else if (arg == "--echo") {
+            config.echo_replies = true;
+        } else if (arg == "--ws-port" && i + 1 < argc) {
+            config.ws_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+        } else if (arg == "--ws-queue" && i + 1 < argc) {
+            config.ws_client_queue = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--shm" && i + 1 < argc) {
+            config.shm_name = argv[++i];
+        } else if (arg == "--shm-records" && i + 1 < argc) {
+            config.shm_records = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--shm-tail" && i + 1 < argc) {
+            return tail_shared_ring(argv[++i]);
+        } else if (arg == "--max-sources" && i + 1 < argc) {
+            config.max_sources = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--history" && i + 1 < argc) {
+            config.history_dir = argv[++i];
+        } else if (arg == "--history-segment-mb" && i + 1 < argc) {
+            config.history_segment_mb = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--history-roll" && i + 1 < argc) {
+            config.history_segment_age_us = whispr::network::parse_duration_us(argv[++i]);
+        } else if (arg == "--history-retention" && i + 1 < argc) {
+            config.history_retention_us = whispr::network::parse_duration_us(argv[++i]);
+        } else if (arg == "--history-query" && i + 1 < argc) {
+            history_query = argv[++i];
+        } else if (arg == "--shards" && i + 1 < argc) {
+            config.listener_shards = static_cast<uint32_t>(std::stoi(argv[++i]));
+        } else if (arg == "--max-connections" && i + 1 < argc) {
+            config.max_concurrent_connections = static_cast<uint32_t>(std::stoi(argv[++i]));
+        } else if (arg == "--queue-capacity" && i + 1 < argc) {
+            // Each slot is a whole parse_job, so cap what a typo can allocate
+            constexpr uint64_t max_queue_capacity = 1u << 24;
+            std::string_view text = argv[++i];
+            uint64_t capacity = 0;
+            auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), capacity);
+            if (ec != std::errc() || end != text.data() + text.size() || capacity < 2 ||
+                capacity > max_queue_capacity || !std::has_single_bit(capacity)) {
+                std::cerr << ansi::BRIGHT_RED << "❌ Invalid queue capacity: " << text 
+                          << " (a power of two from 2 to " << max_queue_capacity << ")" << ansi::RESET << std::endl;
+                return 1;
+            }
+            config.queue_capacity = static_cast<uint32_t>(capacity);
+        } else if (arg == "--overflow" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "drop-newest") config.queue_overflow = whispr::network::overflow_policy::drop_newest;
+            else if (policy == "drop-oldest") config.queue_overflow = whispr::network::overflow_policy::drop_oldest;
+            else if (policy == "block") config.queue_overflow = whispr::network::overflow_policy::block;
+            else {
+                std::cerr << ansi::BRIGHT_RED << "❌ Invalid overflow policy: " << policy 
+                          << " (block, drop-newest or drop-oldest)" << ansi::RESET << std::endl;
+                return 1;
+            }
         } else if (arg == "--no-simd-validation") {
             config.enable_simd_validation = false;
         } else if (arg == "--dashboard") {
@@ -1634,6 +7802,35 @@ int main(int argc, char* argv[]) {
             std::cout << ansi::YELLOW << "  --interval MS          " << ansi::WHITE << "Beacon interval in ms (default: 1000)\n" << ansi::RESET;
             std::cout << ansi::YELLOW << "  --batch-size N         " << ansi::WHITE << "Message batch size (default: 10)\n" << ansi::RESET;
             std::cout << ansi::YELLOW << "  --parse-threads N      " << ansi::WHITE << "Number of parse threads (default: hardware)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --io-threads N         " << ansi::WHITE << "Number of epoll I/O threads (default: 2)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --template-beacons     " << ansi::WHITE << "Render unbatched beacons once, patch digits per send\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --wire json|binary     " << ansi::WHITE << "Beacon encoding for destinations without wire= (default: json)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --log-level LEVEL      " << ansi::WHITE << "debug, info, warn or error (default: info)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --log-sample tx=N|rx=N " << ansi::WHITE << "Log 1 in N sent/received beacons, repeatable\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --no-compression       " << ansi::WHITE << "Send batches as plain JSON\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --linger-us N          " << ansi::WHITE << "Max wait before a partial batch is sent (default: 10000)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --dest [NAME=]HOST:PORT[,every=DUR][,wire=FMT]\n" << ansi::WHITE 
+                      << "                         Beacon destination, repeatable; [v6]:PORT for IPv6,\n"
+                      << "                         own interval e.g. every=250us, every=5ms,\n"
+                      << "                         own encoding wire=json|binary\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --udp-port PORT        " << ansi::WHITE << "UDP beacon listen port, 0 disables (default: 9001)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --echo                 " << ansi::WHITE << "Pong UDP beacons back; track RTT and clock offset per destination\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --ws-port PORT         " << ansi::WHITE << "WebSocket feed for browsers, 0 disables (default: 8083)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --ws-queue N           " << ansi::WHITE << "Frames queued per slow viewer before dropping (default: 256)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --shm NAME             " << ansi::WHITE << "Publish decoded beacons to the shared-memory ring /dev/shm/NAME\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --shm-records N        " << ansi::WHITE << "Shared ring capacity in records (default: 65536)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --shm-tail NAME        " << ansi::WHITE << "Print beacons from another process's shared ring and exit on Ctrl+C\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --max-sources N        " << ansi::WHITE << "Distinct sources tracked for loss and jitter (default: 131072)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --history DIR          " << ansi::WHITE << "Keep every decoded beacon in segment files under DIR\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --history-segment-mb N " << ansi::WHITE << "Roll to a new segment at this size (default: 64)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --history-roll DUR     " << ansi::WHITE << "... or at this age, e.g. 15m (default: 1h)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --history-retention DUR" << ansi::WHITE << " Delete segments older than this, 0 keeps all (default: 7d)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --history-query since=DUR[,until=DUR][,source=ID][,limit=N]\n" << ansi::WHITE 
+                      << "                         Summarise stored beacons from --history DIR and exit\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --shards N             " << ansi::WHITE << "Per-core pinned listener shards, 0 disables (Linux)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --max-connections N    " << ansi::WHITE << "Maximum concurrent TCP clients (default: 10000)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --queue-capacity N     " << ansi::WHITE << "Parse queue capacity, a power of two (default: 65536)\n" << ansi::RESET;
+            std::cout << ansi::YELLOW << "  --overflow POLICY      " << ansi::WHITE << "Full parse queue: block, drop-newest, drop-oldest (default: block)\n" << ansi::RESET;
             std::cout << ansi::YELLOW << "  --no-simd-validation   " << ansi::WHITE << "Disable SIMD validation\n" << ansi::RESET;
             std::cout << ansi::YELLOW << "  --dashboard            " << ansi::WHITE << "Enable beautiful real-time dashboard\n" << ansi::RESET;
             std::cout << ansi::YELLOW << "  --help                 " << ansi::WHITE << "Show this help\n" << ansi::RESET;
@@ -1649,6 +7846,10 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (!history_query.empty()) {
+        return query_history(config.history_dir.empty() ? "." : config.history_dir, history_query);
+    }
+    
     // Create and run application
     try {
         whispr::network::lighthouse_application app(config);
@@ -1672,3 +7873,4 @@ int main(int argc, char* argv[]) {
     
     return 0;
 }
+#endif